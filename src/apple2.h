@@ -15,9 +15,23 @@
 
 #define ZP_START        0x00
 #define ZP_DATAFLG      0x13
+#define ZP_WNDLFT       0x20
+#define ZP_WNDWDTH      0x21
+#define ZP_WNDTOP       0x22
+#define ZP_WNDBTM       0x23
 #define ZP_CH           0x24
 #define ZP_CV           0x25
+#define ZP_BASL         0x28
+#define ZP_BASH         0x29
+#define ZP_BAS2L        0x2A
+#define ZP_BAS2H        0x2B
 #define ZP_PROMPT       0x33
+#define ZP_A1L          0x3C
+#define ZP_A1H          0x3D
+#define ZP_A2L          0x3E
+#define ZP_A2H          0x3F
+#define ZP_A4L          0x42
+#define ZP_A4H          0x43
 #define ZP_LINNUM       0x50
 #define ZP_TXTTAB       0x67
 #define ZP_VARTAB       0x69 // LOMEM
@@ -88,11 +102,21 @@
 
 #define MON_IRQ         0xFA40
 #define MON_BREAK       0xFA4C
+#define MON_BASCALC     0xFBC1
+#define MON_VTAB        0xFC22
+#define MON_VTABZ       0xFC24
+#define MON_CLREOP      0xFC42
+#define MON_HOME        0xFC58
+#define MON_SCROLL      0xFC70
+#define MON_CLREOL      0xFC9C
+#define MON_CLEOLZ      0xFC9E
+#define MON_NXTA4       0xFCB4
 #define MON_KEYIN       0xFD1B
 #define MON_GETLNZ      0xFD67
 #define MON_GETLN       0xFD6A
 #define MON_NXTCHR      0xFD75
 #define MON_COUT1       0xFDF0
+#define MON_MOVE        0xFE2C
 #define MON_GO          0xFEB6
 #define MON_MONZ        0xFF69
 
@@ -0,0 +1,155 @@
+//  batch.c
+//
+//  Copyright (c) 2025 Micah John Cowan.
+//  This code is licensed under the MIT license.
+//  See the accompanying LICENSE file for details.
+
+//  --batch: run many --run-basic jobs from a single bobbin process.
+//
+//  The parent process parses the options and loads (and validates)
+//  the ROM just once, and then fork()s a child for each job, keeping
+//  up to --jobs of them running at a time. Each child is an ordinary
+//  bobbin run with its own copy of the machine, so jobs can't
+//  interfere with one another, and they spread across as many host
+//  cores as there are workers.
+
+#include "bobbin-internal.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+struct job {
+    char *  input;
+    char *  output;
+    pid_t   pid;
+};
+
+static struct job *jobs = NULL;
+static size_t njobs = 0;
+
+static char *copy_str(const char *s)
+{
+    size_t len = strlen(s) + 1;
+    char *c = xalloc(len);
+    memcpy(c, s, len);
+    return c;
+}
+
+static void read_manifest(void)
+{
+    FILE *f = STREQ(cfg.batch_file, "-")? stdin : fopen(cfg.batch_file, "r");
+    if (f == NULL) {
+        DIE(1, "--batch: Couldn't open \"%s\": %s\n", cfg.batch_file,
+            strerror(errno));
+    }
+
+    size_t alloc = 0;
+    char *line = NULL;
+    size_t linesz = 0;
+    unsigned long lineno = 0;
+    while (getline(&line, &linesz, f) != -1) {
+        ++lineno;
+        char *save;
+        char *in = strtok_r(line, " \t\r\n", &save);
+        if (in == NULL || in[0] == '#') continue;
+        char *out = strtok_r(NULL, " \t\r\n", &save);
+        if (out == NULL || strtok_r(NULL, " \t\r\n", &save) != NULL) {
+            DIE(2, "--batch: %s:%lu: expected an input and an output file.\n",
+                cfg.batch_file, lineno);
+        }
+
+        if (njobs == alloc) {
+            alloc = alloc? alloc * 2 : 16;
+            struct job *n = xalloc(alloc * sizeof n[0]);
+            memcpy(n, jobs, njobs * sizeof n[0]);
+            free(jobs);
+            jobs = n;
+        }
+        jobs[njobs].input = copy_str(in);
+        jobs[njobs].output = copy_str(out);
+        jobs[njobs].pid = -1;
+        ++njobs;
+    }
+    free(line);
+    if (f != stdin) fclose(f);
+}
+
+// In the child: point cfg and the standard descriptors at JOB.
+static void become_job(struct job *job)
+{
+    cfg.runbasicfile = job->input;
+
+    int fd = open("/dev/null", O_RDONLY);
+    if (fd >= 0) {
+        dup2(fd, STDIN_FILENO);
+        close(fd);
+    }
+
+    fd = creat(job->output, 0666);
+    if (fd < 0) {
+        DIE(1, "--batch: Couldn't open \"%s\": %s\n", job->output,
+            strerror(errno));
+    }
+    dup2(fd, STDOUT_FILENO);
+    dup2(fd, STDERR_FILENO);
+    close(fd);
+}
+
+void batch_run(void)
+{
+    if (!cfg.batch_file) return;
+
+    read_manifest();
+    mem_load_rom();
+
+    unsigned long workers = cfg.batch_jobs;
+    if (workers == 0) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = n > 0? n : 1;
+    }
+
+    size_t next = 0, running = 0, failed = 0;
+    fflush(NULL);
+    while (next != njobs || running != 0) {
+        if (next != njobs && running < workers) {
+            pid_t pid = fork();
+            if (pid < 0) {
+                DIE(1, "--batch: fork failed: %s\n", strerror(errno));
+            } else if (pid == 0) {
+                become_job(&jobs[next]);
+                return; // ...and go run the machine.
+            }
+            jobs[next++].pid = pid;
+            ++running;
+            continue;
+        }
+
+        int status;
+        pid_t pid = wait(&status);
+        if (pid < 0) {
+            if (errno == EINTR) continue;
+            DIE(1, "--batch: wait failed: %s\n", strerror(errno));
+        }
+        --running;
+
+        struct job *job = jobs;
+        while (job != jobs + njobs && job->pid != pid) ++job;
+        if (job == jobs + njobs) continue;
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            ++failed;
+            if (WIFEXITED(status)) {
+                WARN("--batch: \"%s\" exited with status %d.\n",
+                     job->input, WEXITSTATUS(status));
+            } else {
+                WARN("--batch: \"%s\" was killed by signal %d.\n",
+                     job->input, WTERMSIG(status));
+            }
+        }
+    }
+
+    INFO("--batch: %zu jobs run, %zu failed.\n", njobs, failed);
+    exit(failed? 1 : 0);
+}
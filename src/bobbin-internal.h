@@ -38,6 +38,10 @@ typedef uint8_t     byte;
 
 extern void bobbin_run(void);
 extern word current_pc(void);
+extern bool step_listeners_changed;
+    /* Set when something may have begun wanting EV_PRESTEP, EV_STEP,
+       or debugger() on every instruction, so that bobbin_run()
+       drops out of its fast path to re-check. */
 
 /********** LOGGING **********/
 
@@ -107,15 +111,21 @@ struct Config {
     const char *    disk;
     const char *    disk2;
     bool            hdd_set;
+    const char *    hdd_sync;
     bool            machine_set;
     size_t          amt_ram;
     bool            load_rom;
     const char *    rom_load_file;
     bool            turbo;
     bool            turbo_was_set;
+    double          speed;          // --speed multiplier
+    const char *    io_accel;
     bool            lang_card;
     bool            lang_card_set;
     bool            bell;
+    const char *    cpu_engine;
+    bool            hle;
+    bool            hle_check;
 
     // "simple" interface config:
     bool            remain_after_pipe;
@@ -125,6 +135,11 @@ struct Config {
     bool            die_on_brk;
     bool            debug_on_brk;
     const char *    trace_file;
+    bool            trace_binary;
+    const char *    profile_file;
+    bool            stats;
+    unsigned long   rewind_mb;
+    unsigned long   rewind_interval;
     uintmax_t       trace_start;
     uintmax_t       trace_end;
     bool            trap_success_on;
@@ -140,6 +155,15 @@ struct Config {
     bool            watch;
     bool            tokenize;
     bool            detokenize;
+    const char *    batch_file;
+    unsigned long   batch_jobs;
+    const char *    load_state;
+    const char *    save_state_file;
+    word            save_state_at;
+    const char *    serve_sock;
+    const char *    connect_sock;
+    const char *    record_file;
+    const char *    replay_file;
 };
 extern Config cfg;
 
@@ -192,9 +216,20 @@ extern Cpu theCpu;
                                    | (!!(val) << flag))))
 #define RPTEST(p, flag)     (!!((p) & PMASK(flag)))
 
+extern void cpu_init(void);
 extern void cpu_reset(void);
 extern void cpu_step(void);
 
+// Pre-decoded instruction cache (--cpu-engine cached). A page's
+//  decoded instructions are good only while its entry in
+//  cpu_cache_pgen matches cpu_cache_gen.
+extern unsigned long cpu_cache_gen;
+extern unsigned long cpu_cache_pgen[0x100];
+// Call when the memory map changes.
+static inline void cpu_cache_flush(void) { ++cpu_cache_gen; }
+// Call when memory at LOC is written.
+static inline void cpu_cache_dirty(word loc) { cpu_cache_pgen[HI(loc)] = 0; }
+
 static inline void go_to(word w) {
     PC = w;
 }
@@ -207,6 +242,8 @@ extern bool validate_rom(unsigned char *buf, size_t sz);
 extern bool machine_is_iie(void);
 extern bool machine_is_enhanced_iie(void);
 extern bool machine_has_mousetext(void);
+// True if the loaded ROM matched one of the known checksums.
+extern bool machine_rom_validated(void);
 
 /********** MEMORY **********/
 
@@ -255,9 +292,20 @@ extern const char *get_switch_name(SoftSwitchFlagPos f);
 extern const char *mem_get_acctype_name(MemAccessType m);
 
 extern void mem_init(void);
+// Load the machine ROM, if it hasn't been already (mem_init() does this).
+extern void mem_load_rom(void);
 extern void mem_reset(void);
 extern void mem_reboot(void);
+// Size of the RAM buffer returned by getram(): main, aux, and
+//  language card memory.
+#define MEM_RAM_SIZE    (128 * 1024)
 extern const byte *getram(void);
+// Use BUF (MEM_RAM_SIZE bytes) as the machine's RAM from now on,
+//  or go back to the built-in buffer if NULL. (--load-state)
+extern void mem_use_ram(byte *buf);
+// Copy RAM (MEM_RAM_SIZE bytes) and soft switches SW into the machine,
+//  wholesale. (--rewind)
+extern void mem_restore(const byte *ram, const SoftSwitches sw);
 extern void mem_put(const byte *buf, unsigned long start, size_t sz);
 extern byte peek(word loc);
 extern void poke(word loc, byte val);
@@ -265,6 +313,17 @@ extern void poke(word loc, byte val);
 //  and don't affect or use floating bus values.
 extern byte peek_sneaky(word loc);
 extern void poke_sneaky(word loc, byte val);
+// Host memory backing bus page PG, if reading it is free of side
+//  effects (plain RAM or ROM). Else NULL.
+extern const byte *mem_read_page(byte pg);
+// Have the memory map rebuilt before it's next used. (--stats)
+extern void mem_map_invalidate(void);
+// Copy SZ bytes from the bus at LOC into BUF (mem_dma_read), or from
+//  BUF onto the bus at LOC (mem_dma_write), just as a peek() or poke()
+//  of each byte would - but a page at a time, wherever a page is plain
+//  memory that nothing is watching. (Block devices.)
+extern void mem_dma_read(word loc, byte *buf, size_t sz);
+extern void mem_dma_write(word loc, const byte *buf, size_t sz);
 extern bool mem_match(word loc, unsigned int nargs, ...);
 extern byte *load_rom(const char *fname, size_t expected, bool exact);
 extern void load_ram_finish(void);
@@ -359,6 +418,48 @@ static inline void rts(void) {
     go_to(WORD(lo, hi)+1);
 }
 
+/********** STATE **********/
+
+// Save/restore the machine to/from a file. Return NULL on success,
+//  or an error message.
+extern const char *state_save(const char *path);
+extern const char *state_load(const char *path);
+// --load-state, --save-state-at
+extern void state_init(void);
+
+/********** BATCH **********/
+
+// --batch: fork a process per job; returns only in the children
+extern void batch_run(void);
+
+/********** SERVE **********/
+
+// --serve: wait for clients, once booted; returns only in children
+extern void serve_init(void);
+// --connect: act as a --serve client; never returns
+extern void serve_connect(void);
+
+/********** PROFILE **********/
+
+// --profile: per-location instruction and cycle counts, and a
+//  call graph of subroutines; reported at exit.
+typedef struct {
+    uint32_t    slot;
+    byte        sp;
+    uintmax_t   cycles;
+} ProfileMark;
+
+extern bool profiling;
+extern void profile_init(void);
+// Called around each instruction, while profiling.
+extern void profile_begin(ProfileMark *m);
+extern void profile_end(const ProfileMark *m);
+
+/********** HLE **********/
+
+// Native versions of some ][/][+ monitor routines (--hle)
+extern void hle_init(void);
+
 /********** DELAY-PC **********/
 
 // fns for --delay-until, --load, --load-at, --jump-to
@@ -369,6 +470,13 @@ extern void dlypc_delay_until(word loc);
 extern void dlypc_load_at(word loc);
 extern void dlypc_jump_to(word loc);
 extern void dlypc_reboot(void);
+// Process any --delay-until-pc that's due; true once all are done.
+extern bool dlypc_catch_up(void);
+// The last --delay-until-pc location, if any.
+extern bool dlypc_final_delay(word *loc);
+// --connect/--serve: pass --load (etc.) requests along to a server.
+extern void dlypc_write_requests(FILE *f);
+extern void dlypc_run_request(const char *line);
 
 // iterator abstraction for traversing the files to be loaded
 struct dlypc_file_iter;
@@ -406,13 +514,17 @@ enum EventType {
            Listeners are expected NOT to adjust the PC during this phase,
            as earlier handlers may have taken actions on the assumption
            that we're really here now, and a user using a debugger
-           will have already seen this as the next instr. */
+           will have already seen this as the next instr.
+           Only sent when someone has registered for it, or has
+           an event_pc_hook() at the current PC. */
     EV_PEEK,
         /* Memory is being accessed via the "bus", in read-mode.
-           Use peek_sneaky() to avoid triggering this. */
+           Use peek_sneaky() to avoid triggering this.
+           Only sent for addresses requested via event_watch(). */
     EV_POKE,
         /* Memory is being written to, via the "bus in write-mode.
            Use poke_sneaky() to avoid triggering this.
+           Only sent for addresses requested via event_watch().
 
            WARNING: aux pokes may be going to bit bucket, if
            no 80col card is configured to be present (RAM == 64k).
@@ -449,8 +561,20 @@ enum EventType {
            to indicate via a "disk light" or some such. `val` holds
            the activity type: 0 for drives off, 1 for drive 1 motor
            running, and 2 for drive 2 motor running. */
+    EV_STATE_LOAD,
+        /* The whole machine state was just replaced (load-state).
+           The PC may be anywhere, such as in the middle of a firmware
+           routine the interface would normally have seen begin. */
+    EV_SERVE_CLIENT,
+        /* A --serve child has just taken its client's connection as
+           standard input and output. Whatever the interface read from
+           (or wrote to) them while the machine booted is history. */
 };
 typedef enum EventType EventType;
+#define EV_NUM_TYPES    (EV_SERVE_CLIENT + 1)
+
+typedef unsigned long EventMask;
+#define EVMASK(t)       ((EventMask)1 << (t))
 
 typedef struct Event Event;
 struct Event {
@@ -477,14 +601,37 @@ struct Event {
 typedef void (*event_handler)(Event *e);
 
 extern void events_init(void);
-extern void event_reghandler(event_handler h);
+extern void event_reghandler(event_handler h, EventMask types);
+    /* Register H to receive the event types in TYPES (EVMASK() values
+       OR'd together). H is only ever called for those types. */
 extern void event_unreghandler(event_handler h);
+extern void event_watch(EventType type, word first, word last);
+    /* EV_PEEK and EV_POKE events are only fired for addresses
+       that someone has asked for, via this function (with type
+       EV_PEEK or EV_POKE), for bus addresses FIRST thru LAST,
+       inclusive. Note that these are bus addresses: a handler
+       that only cares about aux memory must still check e->aux. */
+extern void event_pc_hook(EventType type, word pc, event_handler fn);
+    /* Call FN for EV_PRESTEP or EV_STEP (TYPE) only when the PC is
+       at PC. Much cheaper than a handler registered for every step
+       that checks the PC itself. */
+extern bool event_pc_hooked(EventType type, word pc);
+extern bool event_has_handlers(EventType type);
 extern void event_fire_disk_active(int val);
 extern int event_fire_peek(word loc);
 extern bool event_fire_poke(word loc, byte val);
 extern void event_fire_switch(SoftSwitchFlagPos f);
 extern void event_fire(EventType type); // For all other events
 
+#define EVENT_MAP_SIZE  (0x10000 / 32)
+extern uint32_t event_peek_map[EVENT_MAP_SIZE];
+extern uint32_t event_poke_map[EVENT_MAP_SIZE];
+static inline bool event_watched(const uint32_t *map, word loc) {
+    return (map[loc / 32] >> (loc % 32)) & 1;
+}
+// Locations with any event_pc_hook(), of either type.
+extern uint32_t event_pc_map[EVENT_MAP_SIZE];
+
 // frame_timer: resets the timer if exists, creates if not
 extern void frame_timer(unsigned int time, void (*fn)(void));
 // frame_timer_reset: resets the timer if it exists, ignores if not
@@ -507,6 +654,9 @@ struct IfaceDesc {
 extern void interfaces_init(void);
 extern void interfaces_start(void);
 extern void iface_fire(Event *e); // For all other events
+// Set while the interface is handling an event (so that, e.g., PC hooks
+//  it adds can be told apart from the machine's own).
+extern bool iface_handling;
 extern void squawk(int level, bool cont, const char *format, ...);
 
 /********** PERIPHERALS **********/
@@ -537,6 +687,22 @@ extern bool drive_spinning(void);
 extern int active_disk(void);
 extern int eject_disk(int drive);
 extern int insert_disk(int drive, const char *path);
+// If the motor has been switched off and is only spinning down,
+//  stop it now. Returns true if the drives are (now) stopped.
+extern bool disk2_spin_down(void);
+// Controller state, for save-state. Only meaningful while the motor
+//  is off; the disks' contents live in their image files.
+typedef struct Disk2State Disk2State;
+struct Disk2State {
+    bool            drive_two;
+    bool            write_mode;
+    byte            data_register;
+    bool            steppers[4];
+    int             cog[2];
+    unsigned int    halftrack[2];
+};
+extern void disk2_get_state(Disk2State *st);
+extern void disk2_set_state(const Disk2State *st);
 
 // Smartport controller
 extern void smartport_add_image(const char *fname);
@@ -573,6 +739,32 @@ extern int  tracing(void);
 extern void trace_read(word loc, byte val);
 extern void trace_write(word loc, byte val);
 
+// Capture-time filters (--trace-events, --trace-pc, --trace-mem)
+#define TRACE_STEPS     0x01
+#define TRACE_READS     0x02
+#define TRACE_WRITES    0x04
+#define TRACE_SWITCHES  0x08
+#define TRACE_DISK      0x10
+extern void trace_select(unsigned int kinds);
+extern void trace_filter_pc(word first, word last);
+extern void trace_filter_mem(word first, word last);
+// Is anyone interested in trace_read()? (peek() is too hot to call
+//  it unconditionally.)
+extern bool trace_reads;
+
+typedef enum {
+    TD_MOTOR_ON,
+    TD_MOTOR_OFF,
+    TD_SELECT,
+    TD_HALFTRACK,
+    TD_READ,
+    TD_WRITE,
+    TD_HDD_READ,    // val is the block number
+    TD_HDD_WRITE,
+} TraceDiskOp;
+// Disk activity, for --trace-events disk. UNIT is the drive number.
+extern void trace_disk(TraceDiskOp op, int unit, unsigned long val);
+
 /********** DEBUG **********/
 
 typedef int (*printer)(const char * fmt, ...);
@@ -581,8 +773,52 @@ bool command_do(const char *line, printer pr);
 extern void dbg_on(void);
 extern void debugger(void);
 extern bool debugging(void);
+extern bool debugger_wants_steps(void);
+    /* True if debugger() needs to be called before every instruction
+       (we're debugging, or there are breakpoints to check). */
 extern void breakpoint_set(word loc);
 
+/********** REWIND **********/
+
+// --rewind: checkpoints, and a log of the machine's inputs, so that
+//  the debugger can take the machine back in time (rs, rc).
+extern bool rewind_on;          // keeping history
+extern bool rewind_replaying;   // re-running it: inputs come from the log
+extern void rewind_init(void);
+// The machine read VAL from outside itself (a key, a disk byte). While
+//  replaying, returns what it read the first time round.
+extern int rewind_input(int val);
+// While replaying: a card's I/O location was accessed, and (the card
+//  having already been through it) left alone.
+extern void rewind_card_skipped(void);
+// Go back to the last checkpoint at or before instruction INSTRS, and
+//  start replaying. False if history doesn't go back that far; else
+//  *AT is the checkpoint's instruction count.
+extern bool rewind_restore(uintmax_t instrs, uintmax_t *at);
+extern uintmax_t rewind_oldest(void);
+// While replaying, call before each instruction: goes live again once
+//  the replay catches up with the present.
+extern void rewind_step(void);
+// The machine's about to be changed by hand, mid-replay: what was
+//  recorded from here on no longer applies. Goes live; or, if the
+//  Disk ][ can't be put back as it was here, returns false, and the
+//  change mustn't be made.
+extern bool rewind_diverge(void);
+
+/********** RECORD **********/
+
+// --record, --replay: the session's input, to and from a file.
+extern bool record_on;
+extern bool replay_on;
+extern void record_init(void);
+// The interface has answered a read of an I/O location: record the
+//  answer, or (replaying) replace it with the one recorded.
+extern void record_peek(Event *e);
+// --watch is rebooting the machine.
+extern void record_reboot(void);
+// Replaying: if the recording rebooted the machine here, reboot it.
+extern bool replay_reboot_due(void);
+
 /********** TIMING **********/
 
 struct timing_t;
@@ -590,9 +826,72 @@ struct timing_t;
 extern struct timing_t  *timing_init(void);
 extern void             timing_adjust(struct timing_t *);
 
+// Signs of I/O activity, for --io-accel.
+typedef enum {
+    ACCEL_MOTOR_ON,     // a Disk ][ motor was switched on
+    ACCEL_MOTOR_OFF,    // ...or off (though it spins a while longer)
+    ACCEL_BLOCK_IO,     // a hard disk block was read or written
+} AccelSignal;
+extern void timing_io_signal(AccelSignal s);
+
+// The program read the keyboard ($C000), and got val. Watches for the
+//  program sitting in a loop waiting on a key.
+extern void timing_kbd_read(byte val);
+// While the program waits on a key, sleep out the rest of each frame
+//  in poll() on fd, waking as soon as it has input. An interface that
+//  reads keys from a file descriptor registers it here.
+extern void timing_idle_fd(int fd);
+// Might there be input for the interface to read? (Always true, unless
+//  the program is idle and fd has had nothing since the interface last
+//  came up empty.)
+extern bool timing_input_pending(void);
+// The interface looked for input, and there was none.
+extern void timing_input_drained(void);
+
+/********** STATS **********/
+
+// Counters for --stats (and the debugger's "stats" command). They
+//  only advance while stats_on is set.
+#define STATS_NSWITCHES (8 * sizeof (SoftSwitches))
+typedef struct {
+    uintmax_t   cycles;                 // emulated
+    uintmax_t   events[EV_NUM_TYPES];
+    uintmax_t   event_ns[EV_NUM_TYPES]; // host time handling them
+    uintmax_t   peeks[MA_LANG_CARD + 1];
+    uintmax_t   pokes[MA_LANG_CARD + 1];
+    uintmax_t   switches[STATS_NSWITCHES];
+    uintmax_t   periph_calls[8];        // per slot
+    uintmax_t   periph_ns[8];
+    uintmax_t   disk_bytes_read;
+    uintmax_t   disk_bytes_written;
+    uintmax_t   hdd_blocks_read;
+    uintmax_t   hdd_blocks_written;
+    uintmax_t   hdd_cache_hits;         // blocks already in host memory
+    uintmax_t   hdd_cache_misses;
+    uintmax_t   hdd_syncs;              // msync()s of written blocks
+    uintmax_t   hdd_sync_ns;            // ...the host time they took
+    uintmax_t   hdd_sync_max_ns;        // ...and the longest of them
+    uintmax_t   frames_slept;           // timing_adjust() outcomes
+    uintmax_t   frames_catchup;
+    uintmax_t   frames_overrun;
+    uintmax_t   frames_idle;            // ...spent waiting on the keyboard
+    uintmax_t   sleep_ns;
+    uintmax_t   accel_frames;           // run under --io-accel
+    uintmax_t   accel_saved_ns;         // ...and the host time saved
+} StatCounters;
+
+extern bool stats_on;
+extern StatCounters counters;
+extern void stats_init(void);
+extern void stats_enable(bool on);
+extern void stats_print(FILE *f);
+// Host monotonic clock, in ns.
+extern uintmax_t stats_clock(void);
+
 /********** UTIL **********/
 
 extern void *xalloc(size_t sz);
+extern uintmax_t alloc_count; // # of xalloc() calls so far
 extern int mmapfile(const char *fname, byte **buf, size_t *sz, int flags);
 extern const char *get_file_ext(const char *path);
 extern void util_print_state(FILE *f, word pc, Registers *reg);
@@ -613,6 +912,69 @@ extern bool check_watches(void);
 /* TBD */
 extern word print_disasm(FILE *f, word pos, const Registers *regs);
 
+// A copy of everything print_disasm() (resp. util_print_state())
+//  shows, so that it can be printed later; see --trace-binary.
+typedef struct DisasmWindow DisasmWindow;
+struct DisasmWindow {
+    bool    zp;         // two bytes shown, instead of five
+    word    addr;
+    byte    val[5];
+};
+typedef struct DisasmSnap DisasmSnap;
+struct DisasmSnap {
+    word            pc;
+    byte            m[3];   // the instruction's bytes
+    byte            nacc;   // memory the instruction refers to
+    DisasmWindow    acc[2];
+};
+typedef struct StateSnap StateSnap;
+struct StateSnap {
+    Registers   regs;
+    byte        stack[13];  // from SP-3
+    DisasmSnap  dis;
+};
+extern void disasm_snap(DisasmSnap *d, word pc, const Registers *regs);
+extern word disasm_print_snap(FILE *f, const DisasmSnap *d);
+extern void disasm_snap_state(StateSnap *s, word pc, const Registers *reg);
+extern void disasm_print_state(FILE *f, const StateSnap *s);
+
+// One thing written to the trace (see tracefmt.c).
+typedef enum {
+    TR_HEADER = 'H',    // start of a --trace-binary file
+    TR_START = 'B',
+    TR_FINISH = 'E',
+    TR_STEP = 'S',
+    TR_READ = 'R',
+    TR_WRITE = 'W',
+    TR_SWITCH = 'X',    // a soft switch changed
+    TR_DISK = 'D',
+} TraceRecType;
+
+#define TRACE_REC_SIZE      64  // --trace-binary record size
+#define TRACE_TEXT_MAX      62
+#define TRACE_ACCTYPE_MAX   15
+
+typedef struct TraceRec TraceRec;
+struct TraceRec {
+    TraceRecType    type;
+    bool            enhanced;   // TR_HEADER: disassemble 65C02 ops
+    char            text[TRACE_TEXT_MAX + 1];   // TR_START, TR_SWITCH
+    uintmax_t       instr;      // TR_STEP
+    StateSnap       state;      // TR_STEP
+    word            loc;        // TR_READ, TR_WRITE...
+    byte            val;
+    size_t          aloc;
+    bool            aux;
+    char            acctype[TRACE_ACCTYPE_MAX + 1];
+    TraceDiskOp     diskop;     // TR_DISK...
+    byte            unit;
+    unsigned long   num;
+};
+
+extern void tracefmt_encode(byte *buf, const TraceRec *r);
+extern bool tracefmt_decode(TraceRec *r, const byte *buf);
+extern void tracefmt_print(FILE *f, const TraceRec *r);
+
 // Although the Apple II processor is run at 1,022,727.143 Hz most of
 // the time, every 65th cycle is elongated, run at an effective
 // 894,886.25 Hz. Together, they average out to
@@ -25,6 +25,29 @@ word current_pc(void) {
     return current_pc_val;
 }
 
+bool step_listeners_changed = false;
+
+// Does anything need to see every instruction go by?
+static bool need_full_steps(void)
+{
+    return event_has_handlers(EV_PRESTEP) || event_has_handlers(EV_STEP)
+        || debugger_wants_steps();
+}
+
+// Run instructions without any per-instruction events, until the
+// frame is up, or we reach a location that something has hooked,
+// or something may have started wanting the full treatment.
+static void fast_steps(void)
+{
+    step_listeners_changed = false;
+    while (cycle_count < CYCLES_PER_FRAME
+           && !sigint_received && !step_listeners_changed
+           && !event_watched(event_pc_map, PC)) {
+        current_pc_val = PC;
+        cpu_step();
+    }
+}
+
 static void handle_io_opts(void);
 
 void bobbin_run(void)
@@ -33,26 +56,38 @@ void bobbin_run(void)
 
     signals_init();
     machine_init();
+    batch_run(); // With --batch, only returns in a job's process.
     handle_io_opts();
+    serve_connect(); // With --connect, doesn't return.
     hooks_init();
     interfaces_init();
     periph_init();
     mem_init(); // Loads ROM files. Nothing past this point
                 // should be validating options or arguments.
     dlypc_reboot();
+    hle_init();
+    serve_init();
+    profile_init();
+    stats_init();
+    rewind_init();
+    record_init();
     setup_watches();
     interfaces_start();
     struct timing_t *timing = timing_init();
 
     event_fire(EV_RESET);
+    state_init(); // --load-state replaces what reset just set up.
 
     for (;;) /* ever */ {
-        if (!cfg.turbo) {
-            timing_adjust(timing);
-        }
+        timing_adjust(timing);
         if (check_watches()) frame_count = 0;
         cycle_count = 0;
         do {
+            if (!sigint_received && !need_full_steps()) {
+                fast_steps();
+                if (cycle_count >= CYCLES_PER_FRAME) break;
+            }
+
             // Provide hooks the opportunity to alter the PC, here
             do {
                 current_pc_val = PC;
@@ -62,7 +97,10 @@ void bobbin_run(void)
                                             // and since it was  user-requested,
                                             // doesn't get count-limited.
 
-            event_fire(EV_STEP);
+            if (event_has_handlers(EV_STEP)
+                || event_pc_hooked(EV_STEP, PC)) {
+                event_fire(EV_STEP);
+            }
             cpu_step();
         } while (cycle_count < CYCLES_PER_FRAME);
         frame_count += cycle_count / CYCLES_PER_FRAME;
@@ -78,6 +116,22 @@ void bobbin_run(void)
 
 static void handle_io_opts(void)
 {
+    if (cfg.serve_sock) {
+        // Input comes from each client, once we're booted.
+        close(STDIN_FILENO);
+        if (open("/dev/null", O_RDONLY) != STDIN_FILENO) {
+            DIE(1, "--serve: couldn't open /dev/null for input.\n");
+        }
+    }
+
+    if (cfg.replay_file) {
+        // Input comes from the recording.
+        close(STDIN_FILENO);
+        if (open("/dev/null", O_RDONLY) != STDIN_FILENO) {
+            DIE(1, "--replay: couldn't open /dev/null for input.\n");
+        }
+    }
+
     if (cfg.inputfile && !STREQ(cfg.inputfile, "-") && !cfg.detokenize) {
         close(STDIN_FILENO);
         errno = 0;
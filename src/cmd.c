@@ -23,9 +23,15 @@ m\n\
     invoke the Apple ][ monitor.\n\
 disk NUM { eject | load PATH }.\n\
     Eject or load a disk image.\n\
+save-state PATH\n\
+    save the machine's state to a file.\n\
+load-state PATH\n\
+    restore the machine's state from a file.\n\
 ";
 
 static const char SAVE_RAM_STR[] = "save-ram ";
+static const char SAVE_STATE_STR[] = "save-state ";
+static const char LOAD_STATE_STR[] = "load-state ";
 static const char DISK_STR[] = "disk ";
 static const char LOAD_STR[] = "load ";
 
@@ -95,6 +101,24 @@ bool command_do(const char *line, printer pr)
         pr("Success: saved RAM to file \"%s\".\n", line);
 ramsave_bail:
         if (ramfile != NULL) fclose(ramfile);
+    } else if (!memcmp(line, SAVE_STATE_STR, sizeof(SAVE_STATE_STR)-1)) {
+        line += sizeof(SAVE_STATE_STR)-1; // skip to the argument
+        while (*line == ' ') ++line;
+        const char *err = state_save(line);
+        if (err) {
+            pr("ERR: save-state: %s\n", err);
+        } else {
+            pr("Success: saved state to file \"%s\".\n", line);
+        }
+    } else if (!memcmp(line, LOAD_STATE_STR, sizeof(LOAD_STATE_STR)-1)) {
+        line += sizeof(LOAD_STATE_STR)-1; // skip to the argument
+        while (*line == ' ') ++line;
+        const char *err = state_load(line);
+        if (err) {
+            pr("ERR: load-state: %s\n", err);
+        } else {
+            pr("Success: loaded state from file \"%s\".\n", line);
+        }
     } else if (!memcmp(line, DISK_STR, sizeof(DISK_STR)-1)) {
         line += sizeof(DISK_STR)-1; // skip past command
         while (*line == ' ') ++line; // skip WS
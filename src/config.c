@@ -14,6 +14,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 
 Config cfg = {
     .squawk_level = DEFAULT_LEVEL,
@@ -23,7 +24,10 @@ Config cfg = {
     .lang_card = true,
     .bell = true,
     .turbo = true,
+    .speed = 1.0,
+    .rewind_interval = 10,
     .trace_file = "trace.log",
+    .cpu_engine = "interp",
 };
 
 typedef enum {
@@ -84,6 +88,16 @@ void do_ram(const char *s);
 struct fnarg ramfn = {do_ram};
 void do_trace_to(const char *s);
 struct fnarg trace_to_fn = {do_trace_to};
+void do_trace_pc(const char *s);
+struct fnarg trace_pc_fn = {do_trace_pc};
+void do_trace_mem(const char *s);
+struct fnarg trace_mem_fn = {do_trace_mem};
+void do_trace_events(const char *s);
+struct fnarg trace_events_fn = {do_trace_events};
+static bool trace_filters_given = false;
+void do_speed(const char *s);
+struct fnarg speed_fn = {do_speed};
+static bool speed_given = false;
 struct fnarg load_basic = {dlypc_load_basic};
 void do_breakpoint(const char *s);
 struct fnarg breakpoint = {do_breakpoint};
@@ -96,6 +110,8 @@ void dlypc_load_at_s(const char *loc_s);
 struct fnarg load_at_fn = {dlypc_load_at_s};
 void dlypc_jump_to_s(const char *loc_s);
 struct fnarg jump_to_fn = {dlypc_jump_to_s};
+void do_save_state_at(const char *s);
+struct fnarg save_state_at_fn = {do_save_state_at};
 
 const OptInfo options[] = {
     { VERSION_OPT_NAMES, T_FUNCTION, &version },
@@ -111,10 +127,16 @@ const OptInfo options[] = {
     { DISK_OPT_NAMES, T_STRING_ARG, &cfg.disk },
     { DISK2_OPT_NAMES, T_STRING_ARG, &cfg.disk2 },
     { HDD_OPT_NAMES, T_FN_ARG, &hdd, &cfg.hdd_set },
+    { HDD_SYNC_OPT_NAMES, T_STRING_ARG, &cfg.hdd_sync },
     { LANG_CARD_OPT_NAMES, T_BOOL, &cfg.lang_card, &cfg.lang_card_set },
     { BELL_OPT_NAMES, T_BOOL, &cfg.bell },
     { TURBO_OPT_NAMES, T_BOOL, &cfg.turbo, &cfg.turbo_was_set },
+    { SPEED_OPT_NAMES, T_FN_ARG, &speed_fn },
+    { IO_ACCEL_OPT_NAMES, T_STRING_ARG, &cfg.io_accel },
     { RAM_OPT_NAMES, T_FN_ARG, &ramfn },
+    { CPU_ENGINE_OPT_NAMES, T_STRING_ARG, &cfg.cpu_engine },
+    { HLE_OPT_NAMES, T_BOOL, &cfg.hle },
+    { HLE_CHECK_OPT_NAMES, T_BOOL, &cfg.hle_check },
     { ROM_FILE_OPT_NAMES, T_STRING_ARG, &cfg.rom_load_file },
     { ROM_OPT_NAMES, T_BOOL, &cfg.load_rom },
     { LOAD_OPT_NAMES, T_FN_ARG, &load_fn },
@@ -127,7 +149,15 @@ const OptInfo options[] = {
     { DIE_ON_BRK_OPT_NAMES, T_BOOL, &cfg.die_on_brk },
     { DEBUG_ON_BRK_OPT_NAMES, T_BOOL, &cfg.debug_on_brk },
     { BREAKPOINT_OPT_NAMES, T_FN_ARG, &breakpoint },
+    { REWIND_OPT_NAMES, T_ULONG_DEC_ARG, &cfg.rewind_mb },
+    { REWIND_INTERVAL_OPT_NAMES, T_ULONG_DEC_ARG, &cfg.rewind_interval },
     { TRACE_FILE_OPT_NAMES, T_STRING_ARG, &cfg.trace_file },
+    { TRACE_BINARY_OPT_NAMES, T_BOOL, &cfg.trace_binary },
+    { PROFILE_OPT_NAMES, T_STRING_ARG, &cfg.profile_file },
+    { STATS_OPT_NAMES, T_BOOL, &cfg.stats },
+    { TRACE_PC_OPT_NAMES, T_FN_ARG, &trace_pc_fn },
+    { TRACE_MEM_OPT_NAMES, T_FN_ARG, &trace_mem_fn },
+    { TRACE_EVENTS_OPT_NAMES, T_FN_ARG, &trace_events_fn },
     { TRACE_TO_OPT_NAMES, T_FN_ARG, &trace_to_fn },
     { TRAP_FAILURE_OPT_NAMES, T_WORD_ARG, &cfg.trap_failure,
         &cfg.trap_failure_on },
@@ -140,6 +170,14 @@ const OptInfo options[] = {
     { WATCH_OPT_NAMES, T_BOOL, &cfg.watch },
     { TOKENIZE_OPT_NAMES, T_BOOL, &cfg.tokenize },
     { DETOKENIZE_OPT_NAMES, T_BOOL, &cfg.detokenize },
+    { BATCH_OPT_NAMES, T_STRING_ARG, &cfg.batch_file },
+    { JOBS_OPT_NAMES, T_ULONG_DEC_ARG, &cfg.batch_jobs },
+    { LOAD_STATE_OPT_NAMES, T_STRING_ARG, &cfg.load_state },
+    { SAVE_STATE_AT_OPT_NAMES, T_FN_ARG, &save_state_at_fn },
+    { SERVE_OPT_NAMES, T_STRING_ARG, &cfg.serve_sock },
+    { CONNECT_OPT_NAMES, T_STRING_ARG, &cfg.connect_sock },
+    { RECORD_OPT_NAMES, T_STRING_ARG, &cfg.record_file },
+    { REPLAY_OPT_NAMES, T_STRING_ARG, &cfg.replay_file },
     { MAX_RUNTIME_OPT_NAMES, T_ULONG_DEC_ARG, &cfg.max_frames },
     { BOT_MODE_OPT_NAMES, T_BOOL, &cfg.bot_mode },
 };
@@ -310,10 +348,83 @@ recheck:// Past this point, can't assume opt points at a real argv[] item
                "--remain, --remain-tty, --tokenize, or --detokenize.");
     }
 
+    if (cfg.batch_file &&
+        (cfg.runbasicfile ||
+         cfg.inputfile ||
+         cfg.outputfile ||
+         cfg.remain_after_pipe ||
+         cfg.remain_tty ||
+         cfg.tokenize ||
+         cfg.detokenize ||
+         // Every job would write (over) the same file.
+         cfg.record_file ||
+         cfg.trace_start != cfg.trace_end ||
+         trace_filters_given ||
+         cfg.profile_file ||
+         cfg.save_state_file ||
+         cfg.stats)) {
+
+        DIE(2, "Cannot specify --batch together with --run-basic, -i, -o, "
+               "--remain, --remain-tty, --tokenize, --detokenize, --record, "
+               "--trace-to, --trace-pc, --trace-mem, --trace-events, "
+               "--profile, --save-state-at, or --stats.\n");
+    }
+
+    if (cfg.serve_sock &&
+        (cfg.connect_sock ||
+         cfg.batch_file ||
+         cfg.runbasicfile ||
+         cfg.inputfile ||
+         cfg.remain_after_pipe ||
+         cfg.remain_tty ||
+         cfg.watch ||
+         cfg.save_state_file ||
+         cfg.tokenize ||
+         cfg.detokenize)) {
+
+        DIE(2, "Cannot specify --serve together with --connect, --batch, "
+               "--run-basic, -i, --remain, --remain-tty, --watch, "
+               "--save-state-at, --tokenize, or --detokenize.");
+    }
+
+    if (cfg.replay_file &&
+        (cfg.record_file ||
+         cfg.serve_sock ||
+         cfg.connect_sock ||
+         cfg.batch_file ||
+         cfg.runbasicfile ||
+         cfg.inputfile ||
+         cfg.remain_after_pipe ||
+         cfg.remain_tty ||
+         cfg.tokenize ||
+         cfg.detokenize)) {
+
+        DIE(2, "Cannot specify --replay together with --record, --serve, "
+               "--connect, --batch, --run-basic, -i, --remain, --remain-tty, "
+               "--tokenize, or --detokenize.");
+    }
+
     // After all's done, do some fixup
     if (cfg.detokenize) {
         dlypc_load_basic(cfg.inputfile? cfg.inputfile : "/dev/stdin");
     }
+    // --speed means pacing, unless --turbo was asked for as well.
+    if (speed_given && !cfg.turbo_was_set) {
+        cfg.turbo = false;
+    }
+    // --replay runs flat out: nobody's watching.
+    if (cfg.replay_file) {
+        cfg.turbo = true;
+    }
+    // Trace filters, but no --trace-to? Then trace the whole run.
+    if (trace_filters_given && cfg.trace_start == cfg.trace_end) {
+        cfg.trace_start = 0;
+        cfg.trace_end = UINTMAX_MAX;
+    }
+    // (Only now that all the --trace-pc ranges are known.)
+    if (cfg.trace_start != cfg.trace_end) {
+        trace_reg();
+    }
     // User specifies runtime in secs, we want it in frames
     if (cfg.max_frames != 0) {
         cfg.max_frames *= 60;
@@ -342,7 +453,9 @@ PACKAGE_URL "\n"
 
 void do_help(void)
 {
-    fputs(help_text, stdout);
+    for (const char * const *p = help_text; *p != NULL; ++p) {
+        fputs(*p, stdout);
+    }
     exit(0);
 }
 
@@ -422,8 +535,95 @@ void do_trace_to(const char *arg)
     }
 
     ++cfg.trace_end;
+}
+
+void do_speed(const char *arg)
+{
+    char *end;
+    errno = 0;
+    double speed = strtod(arg, &end);
+    if (end != arg && (*end == 'x' || *end == 'X')) ++end;
+    if (errno != 0 || end == arg || *end != '\0' || !(speed > 0)) {
+        DIE(2, "--speed: \"%s\" is not a positive number.\n", arg);
+    }
+    if (speed < 0.01 || speed > 1000) {
+        DIE(2, "--speed: must be from 0.01 to 1000.\n");
+    }
+    cfg.speed = speed;
+    speed_given = true;
+}
+
+// Parses "FIRST-LAST" (or just "FIRST") for --trace-pc, --trace-mem.
+static void parse_range(const char *opt, const char *arg,
+                        word *first, word *last)
+{
+    char buf[16];
+    const char *dash = strchr(arg, '-');
+    if (dash == NULL) {
+        handle_numeric_arg(T_WORD_ARG, opt, first, arg);
+        *last = *first;
+        return;
+    }
+    if (dash - arg >= sizeof buf) {
+        DIE(2, "Could not parse numeric arg to --%s.\n", opt);
+    }
+    memcpy(buf, arg, dash - arg);
+    buf[dash - arg] = '\0';
+    handle_numeric_arg(T_WORD_ARG, opt, first, buf);
+    handle_numeric_arg(T_WORD_ARG, opt, last, dash + 1);
+    if (*last < *first) {
+        DIE(2, "Range to --%s ends before it starts.\n", opt);
+    }
+}
 
-    trace_reg();
+void do_trace_pc(const char *arg)
+{
+    word first, last;
+    parse_range("trace-pc", arg, &first, &last);
+    trace_filter_pc(first, last);
+    trace_filters_given = true;
+}
+
+void do_trace_mem(const char *arg)
+{
+    word first, last;
+    parse_range("trace-mem", arg, &first, &last);
+    trace_filter_mem(first, last);
+    trace_filters_given = true;
+}
+
+void do_trace_events(const char *arg)
+{
+    static const struct {
+        const char *name;
+        unsigned int kind;
+    } names[] = {
+        { "steps", TRACE_STEPS },
+        { "reads", TRACE_READS },
+        { "writes", TRACE_WRITES },
+        { "switches", TRACE_SWITCHES },
+        { "disk", TRACE_DISK },
+    };
+
+    unsigned int kinds = 0;
+    size_t len;
+    for (; *arg != '\0'; arg += len + (arg[len] == ',')) {
+        len = strcspn(arg, ",");
+        size_t i;
+        for (i = 0; i != sizeof names / sizeof names[0]; ++i) {
+            if (strlen(names[i].name) == len
+                && strncasecmp(names[i].name, arg, len) == 0) {
+                break;
+            }
+        }
+        if (i == sizeof names / sizeof names[0]) {
+            DIE(2, "--trace-events: unknown event type \"%.*s\".\n",
+                (int)len, arg);
+        }
+        kinds |= names[i].kind;
+    }
+    trace_select(kinds);
+    trace_filters_given = true;
 }
 
 void do_breakpoint(const char *arg)
@@ -437,6 +637,28 @@ void do_breakpoint(const char *arg)
     breakpoint_set(bploc);
 }
 
+void do_save_state_at(const char *arg)
+{
+    const char *colon = strchr(arg, ':');
+    if (colon == NULL || colon == arg || colon[1] == '\0') {
+        DIE(2, "--save-state-at: expected LOC:FILE.\n");
+    }
+
+    char loc_s[16];
+    size_t len = colon - arg;
+    if (len >= sizeof loc_s) len = sizeof loc_s - 1;
+    memcpy(loc_s, arg, len);
+    loc_s[len] = '\0';
+
+    if (STREQCASE("input", loc_s)) {
+        cfg.save_state_at = MON_KEYIN;
+    } else {
+        handle_numeric_arg(T_WORD_ARG, "save-state-at", &cfg.save_state_at,
+                           loc_s);
+    }
+    cfg.save_state_file = colon + 1;
+}
+
 void dlypc_delay_until_s(const char *loc_s) {
     word   loc;
     if (STREQCASE("input", loc_s)) {
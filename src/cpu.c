@@ -44,6 +44,26 @@ void cpu_reset(void)
     cycle(); /* end of cycle 7 (8th); read vector high byte */
 }
 
+/* Cycle accounting. Normally, cycle_count is advanced at each cycle
+   boundary within an instruction, so that anything that looks at it
+   mid-instruction sees exactly where we are.
+
+   Built with --enable-batched-cycles, the instruction handlers below
+   don't count their cycles: each opcode's fixed cost (from
+   cycles_6502[] et al) is added once, as the instruction starts,
+   and only the cycles that vary (page crossings, branches taken)
+   are counted as they happen, via cycle_extra(). Totals at
+   instruction boundaries are the same either way; nothing in
+   bobbin currently looks at cycle_count mid-instruction. */
+#ifdef BATCHED_CYCLES
+#  define cycle()           ((void)0)
+#  define cycle_extra()     ((void)++cycle_count)
+#  define cycles_base(op)   ((void)(cycle_count += cycletable[op]))
+#else
+#  define cycle_extra()     cycle()
+#  define cycles_base(op)   ((void)0)
+#endif
+
 // Sign extend
 #define SE(v)  (((v) & 0x80)? ((v) | 0xFF00) : (v))
 // "Negation"
@@ -142,11 +162,11 @@ void cpu_reset(void)
             cycle(); /* 3 */\
             (void) peek(PC); \
             if (PC != addr) { \
-                cycle(); /* 4 */ \
+                cycle_extra(); /* 4 */ \
                 go_to(addr); \
                 (void) peek(PC); \
             } \
-            cycle(); /* 4 or 5 */ \
+            cycle_extra(); /* 4 or 5 */ \
         } else { \
             cycle(); /* 3 */ \
         } \
@@ -166,7 +186,7 @@ void cpu_reset(void)
         if (addr == wrAddr) { \
             exec; \
         } else { \
-            cycle(); /* 5 */ \
+            cycle_extra(); /* 5 */ \
             val = peek(addr); \
             exec; \
         } \
@@ -212,7 +232,7 @@ void cpu_reset(void)
         if (addr == wrAddr) { \
             exec; \
         } else { \
-            cycle(); \
+            cycle_extra(); \
             val = peek(addr); \
             exec; \
         } \
@@ -481,18 +501,20 @@ void handle_brk_or_illegal(byte op) {
     else {
         // XXX cycles and behavior not realistic
         //  for non-break unsupported op-codes
+        // (Counted with cycle_extra(), as they don't apply when
+        //  we bail to the debugger instead.)
         PC_ADV;
-        cycle(); // end 2
+        cycle_extra(); // end 2
 
         stack_push(HI(PC));
-        cycle(); // 3
+        cycle_extra(); // 3
         stack_push(LO(PC));
-        cycle(); // 4
+        cycle_extra(); // 4
         stack_push_flags_or(PMASK(PBRK));
-        cycle(); // 5
+        cycle_extra(); // 5
 
         byte pcL = peek(VEC_BRK);
-        cycle(); // 6
+        cycle_extra(); // 6
         byte pcH = peek(VEC_BRK + 1);
         go_to(WORD(pcL, pcH));
         PPUT(PINT,1);
@@ -502,813 +524,1829 @@ void handle_brk_or_illegal(byte op) {
             // http://www.6502.org/tutorials/65c02opcodes.html#:~:text=also%20clear%20the%20D%20flag
             PPUT(PDEC,0);
         }
-        cycle(); // 7
+        cycle_extra(); // 7
     }
 }
 
-bool cpu_step_65C02(byte op, byte immed)
-{
-    /* This function returns true if it found (and handled) an
-       extended 65C02 opcode. Returns false if caller should handle
-       opcode that also exists in 6502. */
-
-    switch (op) {
-        case 0x04: // TSB zp - Test and Set Bits, Zero Page (MOS 65C02 only)
-            OP_RMW_ZP(
-                PPUT(PZERO, (val & ACC) == 0);
-                val |= ACC;
-            );
-            break;
-        case 0x0C: // TSB abs - Test and Set Bits, Absolute (MOS 65C02 only)
-            OP_RMW_ABS(
-                PPUT(PZERO, (val & ACC) == 0);
-                val |= ACC;
-            );
-            break;
-        case 0x12: // ORA (zp) - OR with Accumulator, Zero Page Indirect (MOS 65C02 only)
-            {
-                byte zp_addr = immed;
-                PC_ADV;
-                cycle();
-                byte lo = peek(zp_addr);
-                cycle();
-                byte hi = peek((zp_addr + 1) & 0xFF);
-                cycle();
-                byte val = peek(WORD(lo, hi));
-                ff(ACC |= val);
-                cycle();
-            }
-            break;
-        case 0x14: // TRB zp - Test and Reset Bits, Zero Page (MOS 65C02 only)
-            OP_RMW_ZP(
-                PPUT(PZERO, (val & ACC) == 0);
-                val &= ~ACC;
-            );
-            break;
-        case 0x1A: // INC A (MOS 65C02) / NOP (6502) - ProDOS 2.4.2 uses this to distinguish CPU types
-            OP_RMW_IMPL(ff(++ACC));
-            break;
-        case 0x1C: // TRB abs - Test and Reset Bits, Absolute (MOS 65C02 only)
-            OP_RMW_ABS(
-                PPUT(PZERO, (val & ACC) == 0);
-                val &= ~ACC;
-            );
-            break;
-        case 0x32: // AND (zp) - AND with Accumulator, Zero Page Indirect (MOS 65C02 only)
-            {
-                byte zp_addr = immed;
-                PC_ADV;
-                cycle();
-                byte lo = peek(zp_addr);
-                cycle();
-                byte hi = peek((zp_addr + 1) & 0xFF);
-                cycle();
-                byte val = peek(WORD(lo, hi));
-                ff(ACC &= val);
-                cycle();
-            }
-            break;
-        case 0x34: // BIT zp,X - BIT Zero Page,X (MOS 65C02 only)
-            OP_READ_ZP_IDX(XREG, do_bit(val));
-            break;
-        case 0x3A: // DEC A (MOS 65C02) / NOP (6502)
-            OP_RMW_IMPL(ff(--ACC));
-            break;
-        case 0x3C: // BIT abs,X - BIT Absolute,X (MOS 65C02 only)
-            OP_READ_ABS_IDX(XREG, do_bit(val));
-            break;
-        case 0x52: // EOR (zp) - Exclusive OR, Zero Page Indirect (MOS 65C02 only)
-            {
-                byte zp_addr = immed;
-                PC_ADV;
-                cycle();
-                byte lo = peek(zp_addr);
-                cycle();
-                byte hi = peek((zp_addr + 1) & 0xFF);
-                cycle();
-                byte val = peek(WORD(lo, hi));
-                ff(ACC ^= val);
-                cycle();
-            }
-            break;
-        case 0x5A: // PHY (Push Y) - MOS 65C02 only
-            cycle();
-            stack_push(YREG);
-            cycle();
-            break;
-        case 0x64: // STZ zp - Store Zero, Zero Page (MOS 65C02 only)
-            OP_WRITE_ZP(0);
-            break;
-        case 0x72: // ADC (zp) - Add with Carry, Zero Page Indirect (MOS 65C02 only)
-            {
-                byte zp_addr = immed;
-                PC_ADV;
-                cycle();
-                byte lo = peek(zp_addr);
-                cycle();
-                byte hi = peek((zp_addr + 1) & 0xFF);
-                cycle();
-                byte val = peek(WORD(lo, hi));
-                do_adc(val);
-                cycle();
-            }
-            break;
-        case 0x74: // STZ zp,X - Store Zero, Zero Page,X (MOS 65C02 only)
-            OP_WRITE_ZP_IDX(XREG, 0);
-            break;
-        case 0x7A: // PLY (Pull Y) - MOS 65C02 only
-            {
-                cycle();
-                stack_inc();
-                cycle();
-                YREG = peek(STACK);
-                ff(YREG);
-                cycle();
-            }
-            break;
-        case 0x7C: // JMP (abs,X) - Jump Absolute Indirect Indexed (MOS 65C02 only)
-            {
-                byte lo = immed;
-                PC_ADV;
-                cycle();
-                byte hi = pc_get_adv();
-                cycle();
-                word base_addr = WORD(lo, hi);
-                word addr = base_addr + XREG;
-                cycle();
-                lo = peek(addr);
-                cycle();
-                hi = peek(addr + 1);
-                word dest = WORD(lo, hi);
-                go_to(dest);
-                cycle();
-            }
-            break;
-        case 0x80: // BRA (Branch Always) - MOS 65C02 only
-            OP_BRANCH(true);
-            break;
-        case 0x89: // BIT #imm - BIT Immediate (MOS 65C02 only)
-            OP_READ_IMM(PPUT(PZERO, (ACC & val) == 0));
-            break;
-        case 0x92: // STA (zp) - Store Accumulator, Zero Page Indirect (MOS 65C02 only)
-            {
-                byte zp_addr = immed;
-                PC_ADV;
-                cycle();
-                byte lo = peek(zp_addr);
-                cycle();
-                byte hi = peek((zp_addr + 1) & 0xFF);
-                cycle();
-                poke(WORD(lo, hi), ACC);
-                cycle();
-            }
-            break;
-        case 0x9C: // STZ abs - Store Zero, Absolute (MOS 65C02 only)
-            OP_WRITE_ABS(0);
-            break;
-        case 0x9E: // STZ abs,X - Store Zero, Absolute,X (MOS 65C02 only)
-            OP_WRITE_ABS_IDX(XREG, 0);
-            break;
-        case 0xB2: // LDA (zp) - Load Accumulator, Zero Page Indirect (MOS 65C02 only)
-            {
-                byte zp_addr = immed;
-                PC_ADV;
-                cycle();
-                byte lo = peek(zp_addr);
-                cycle();
-                byte hi = peek((zp_addr + 1) & 0xFF);
-                cycle();
-                byte val = peek(WORD(lo, hi));
-                ff(ACC = val);
-                cycle();
-            }
-            break;
-        case 0xD2: // CMP, (ZP)
-            {
-                byte zp_addr = immed;
-                PC_ADV;
-                cycle();
-                byte lo = peek(zp_addr);
-                cycle();
-                byte hi = peek((zp_addr + 1) & 0xFF);
-                cycle();
-                byte val = peek(WORD(lo, hi));
-                do_cmp(ACC, val);
-                cycle();
-            }
-            break;
-        case 0xDA: // PHX (Push X) - MOS 65C02 only
-            cycle();
-            stack_push(XREG);
-            cycle();
-            break;
-        case 0xF2: // SBC (zp) - Subtract with Borrow, Zero Page Indirect (MOS 65C02 only)
-            {
-                byte zp_addr = immed;
-                PC_ADV;
-                cycle();
-                byte lo = peek(zp_addr);
-                cycle();
-                byte hi = peek((zp_addr + 1) & 0xFF);
-                cycle();
-                byte val = peek(WORD(lo, hi));
-                do_sbc(val);
-                cycle();
-            }
-            break;
-        case 0xFA: // PLX (Pull X) - MOS 65C02 only
-            {
-                cycle();
-                stack_inc();
-                cycle();
-                XREG = peek(STACK);
-                ff(XREG);
-                cycle();
-            }
-            break;
-        default:   // UNRECOGNIZED OPCODE (treat as BRK)
-            return false; // We DID NOT handle
-    }
+typedef void (*OpHandler)(byte op, byte immed);
 
-    return true; // handled.
-}
-
-bool cpu_step_6502(byte op, byte immed)
-{
-    switch (op) {
-        case 0x01: // ORA, (MEM,x).
-            OP_READ_INDX(ff(ACC |= val));
-            break;
-        case 0x05: // ORA, ZP
-            OP_READ_ZP(ff(ACC |= val));
-            break;
-        case 0x06: // ASL, ZP
-            OP_RMW_ZP(val = do_asl(val));
-            break;
-        case 0x08: // PHP (impl.)
-            cycle();
-            stack_push_flags_or(1 << PBRK);
-            cycle();
-            break;
-        case 0x09: // ORA, immed.
-            OP_READ_IMM(ff(ACC |= immed));
-            break;
-        case 0x0A: // ASL, impl.
-            OP_RMW_IMPL(ACC = do_asl(ACC));
-            break;
-        case 0x0D: // ORA, abs
-            OP_READ_ABS(ff(ACC |= val));
-            break;
-        case 0x0E: // ASL, abs
-            OP_RMW_ABS(val = do_asl(val));
-            break;
-        case 0x10: // BPL
-            OP_BRANCH(!PTEST(PNEG));
-            break;
-        case 0x11: // ORA, (MEM),y
-            OP_READ_INDY(ff(ACC |= val));
-            break;
-        case 0x15: // ORA, ZP,x
-            OP_READ_ZP_IDX(XREG, ff(ACC |= val));
-            break;
-        case 0x16: // ASL, ZP,x
-            OP_RMW_ZP_IDX(XREG, val = do_asl(val));
-            break;
-        case 0x18: // CLC (impl.)
-            OP_RMW_IMPL(PPUT(PCARRY, 0));
-            break;
-        case 0x19: // ORA, MEM,y
-            OP_READ_ABS_IDX(YREG, ff(ACC |= val));
-            break;
-        case 0x1A: // UNDOCUMENTED nop (when 6502). ProDOS 2.4.2 uses it
-                   //  to distinguish CPU types...
-                   //  # cycles/order of ops may be wrong...
-            OP_RMW_IMPL(); // NOP behavior - empty statement
-            break;
-        case 0x1D: // ORA, MEM,x
-            OP_READ_ABS_IDX(XREG, ff(ACC |= val));
-            break;
-        case 0x1E: // ASL, MEM,x
-            OP_RMW_ABS_IDX(XREG, val = do_asl(val));
-            break;
-        case 0x20: // JSR
-            {
-                byte lo = immed;
-                PC_ADV;
-                cycle();
-                (void) stack_get();
-                cycle();
-                stack_push(HI(PC));
-                cycle();
-                stack_push(LO(PC));
-                cycle();
-                word dest = WORD(lo, peek(PC));
-                go_to(dest);
-                cycle();
-            }
-            break;
-        case 0x21: // AND, (MEM,x)
-            OP_READ_INDX(ff(ACC &= val));
-            break;
-        case 0x24: // BIT, ZP
-            OP_READ_ZP(do_bit(val));
-            break;
-        case 0x25: // AND, ZP
-            OP_READ_ZP(ff(ACC &= val));
-            break;
-        case 0x26: // ROL, ZP
-            OP_RMW_ZP(val = do_rol(val));
-            break;
-        case 0x28: // PLP (impl.)
-            {
-                cycle();
-                stack_inc();
-                cycle();
-                byte p = peek(STACK);
-                // BRK and UNUSED must always be set; they're not real
-                //  flags (no associated flip flops)
-                PFLAGS = p | PMASK(PUNUSED) | PMASK(PBRK);
-                cycle();
-            }
-            break;
-        case 0x29: // AND, imm
-            OP_READ_IMM(ff(ACC &= val));
-            break;
-        case 0x2A: // ROL, impl.
-            OP_RMW_IMPL(ACC = do_rol(ACC));
-            break;
-        case 0x2C: // BIT, abs
-            OP_READ_ABS(do_bit(val));
-            break;
-        case 0x2D: // AND, abs
-            OP_READ_ABS(ff(ACC &= val));
-            break;
-        case 0x2E: // ROL, abs
-            OP_RMW_ABS(val = do_rol(val));
-            break;
-        case 0x30: // BMI
-            OP_BRANCH(PTEST(PNEG));
-            break;
-        case 0x31: // AND, (MEM),y
-            OP_READ_INDY(ff(ACC &= val));
-            break;
-        case 0x35: // AND, ZP,x
-            OP_READ_ZP_IDX(XREG, ff(ACC &= val));
-            break;
-        case 0x36: // ROL, ZP,x
-            OP_RMW_ZP_IDX(XREG, val = do_rol(val));
-            break;
-        case 0x38: // SEC (impl.)
-            OP_RMW_IMPL(PPUT(PCARRY, 1));
-            break;
-        case 0x39: // AND, MEM,y
-            OP_READ_ABS_IDX(YREG, ff(ACC &= val));
-            break;
-        case 0x3A: // On 6502, this is an undocumented NOP instruction
-            OP_RMW_IMPL(); // NOP behavior - empty statement
-            break;
-        case 0x3D: // AND, MEM,x
-            OP_READ_ABS_IDX(XREG, ff(ACC &= val));
-            break;
-        case 0x3E: // ROL, MEM,x
-            OP_RMW_ABS_IDX(XREG, val = do_rol(val));
-            break;
-        case 0x40: // RTI
-            {
-                cycle(); // end 2
-                byte p = stack_pop();
-                cycle(); // 3
-                PFLAGS = (p & 0xCF) | PMASK(PUNUSED);
-                byte lo = stack_pop();
-                cycle(); // 4
-                go_to(WORD(lo, HI(PC)));
-                byte hi = stack_pop();
-                cycle(); // 5
-                go_to(WORD(lo, hi));
-                (void) peek(STACK);
-                cycle(); // 6
-            }
-            break;
-        case 0x41: // EOR, (MEM,x)
-            OP_READ_INDX(ff(ACC ^= val));
-            break;
-        case 0x45: // EOR, ZP
-            OP_READ_ZP(ff(ACC ^= val));
-            break;
-        case 0x46: // LSR, ZP
-            OP_RMW_ZP(val = do_lsr(val));
-            break;
-        case 0x48: // PHA
-            cycle();
-            stack_push(ACC);
-            cycle();
-            break;
-        case 0x49: // EOR, imm
-            OP_READ_IMM(ff(ACC ^= val));
-            break;
-        case 0x4A: // LSR, impl.
-            OP_RMW_IMPL(ACC = do_lsr(ACC));
-            break;
-        case 0x4C: // JMP
-            {
-                byte lo = immed;
-                PC_ADV;
-                cycle();
-                byte hi = pc_get_adv();
-                word dest = WORD(lo, hi);
-                go_to(dest);
-                cycle();
-            }
-            break;
-        case 0x4D: // EOR, abs
-            OP_READ_ABS(ff(ACC ^= val));
-            break;
-        case 0x4E: // LSR, abs
-            OP_RMW_ABS(val = do_lsr(val));
-            break;
-        case 0x50: // BVC
-            OP_BRANCH(!PTEST(POVERFL));
-            break;
-        case 0x51: // EOR, (MEM),y
-            OP_READ_INDY(ff(ACC ^= val));
-            break;
-        case 0x55: // EOR, ZP,x
-            OP_READ_ZP_IDX(XREG, ff(ACC ^= val));
-            break;
-        case 0x56: // LSR, ZP,x
-            OP_RMW_ZP_IDX(XREG, val = do_lsr(val));
-            break;
-        case 0x58: // CLI
-            OP_RMW_IMPL(PPUT(PINT, 0));
-            break;
-        case 0x59: // EOR, MEM,y
-            OP_READ_ABS_IDX(YREG, ff(ACC ^= val));
-            break;
-        case 0x5D: // EOR, MEM,x
-            OP_READ_ABS_IDX(XREG, ff(ACC ^= val));
-            break;
-        case 0x5E: // LSR, MEM,x
-            OP_RMW_ABS_IDX(XREG, val = do_lsr(val));
-            break;
-        case 0x60: // RTS
-            {
-                word orig = PC;
-                cycle(); // end 2
-                byte lo = stack_pop();
-                cycle(); // 3
-                go_to(WORD(lo, HI(PC)));
-                (void) stack_pop();
-                cycle(); // 4
-                byte hi = peek(STACK);
-                word dest = WORD(lo, hi);
-                go_to(dest);
-                cycle(); // 5
-                PC_ADV;
-                cycle(); // 6
-            }
-            break;
-        case 0x61: // ADC, (MEM,x)
-            OP_READ_INDX(do_adc(val));
-            break;
-        case 0x65: // ADC, ZP
-            OP_READ_ZP(do_adc(val));
-            break;
-        case 0x66: // ROR, ZP
-            OP_RMW_ZP(val = do_ror(val));
-            break;
-        case 0x68: // PLA
-            cycle();
-            (void) stack_pop();
-            cycle();
-            ff(ACC = peek(STACK));
-            cycle();
-            break;
-        case 0x69: // ADC, imm
-            OP_READ_IMM(do_adc(val));
-            break;
-        case 0x6A: // ROR, impl.
-            OP_RMW_IMPL(ACC = do_ror(ACC));
-            break;
-        case 0x6C: // JMP ()
-            {
-                byte lo = immed;
-                PC_ADV;
-                cycle(); // 2
-                byte hi = pc_get_adv();
-                word addr = WORD(lo,hi);
-                cycle(); // 3
-                lo = peek(addr);
-                cycle(); // 4
-                if (machine_is_enhanced_iie()) {
-                    hi = peek(addr+1);
-                } else {
-                    // 6502 page-crossing BUG!!
-                    hi = peek(WORD(LO(addr+1),HI(addr)));
-                }
-                word dest = WORD(lo, hi);
-                go_to(dest);
-                cycle(); // 5
-            }
-            break;
-        case 0x6D: // ADC, abs
-            OP_READ_ABS(do_adc(val));
-            break;
-        case 0x6E: // ROR, abs
-            OP_RMW_ABS(val = do_ror(val));
-            break;
-        case 0x70: // BVS
-            OP_BRANCH(PTEST(POVERFL));
-            break;
-        case 0x71: // ADC, (MEM),y
-            OP_READ_INDY(do_adc(val));
-            break;
-        case 0x75: // ADC, ZP,x
-            OP_READ_ZP_IDX(XREG, do_adc(val));
-            break;
-        case 0x76: // ROR, ZP,x
-            OP_RMW_ZP_IDX(XREG, val = do_ror(val));
-            break;
-        case 0x78: // SEI
-            OP_RMW_IMPL(PPUT(PINT, 1));
-            break;
-        case 0x79: // ADC MEM,y
-            OP_READ_ABS_IDX(YREG, do_adc(val));
-            break;
-        case 0x7D: // ADC, MEM,x
-            OP_READ_ABS_IDX(XREG, do_adc(val));
-            break;
-        case 0x7E: // ROR, MEM,x
-            OP_RMW_ABS_IDX(XREG, val = do_ror(val));
-            break;
-        case 0x81: // STA, (MEM,x)
-            OP_WRITE_INDX(ACC);
-            break;
-        case 0x84: // STY, ZP
-            OP_WRITE_ZP(YREG);
-            break;
-        case 0x85: // STA, ZP
-            OP_WRITE_ZP(ACC);
-            break;
-        case 0x86: // STX, ZP
-            OP_WRITE_ZP(XREG);
-            break;
-        case 0x88: // DEY
-            OP_RMW_IMPL(ff(--YREG));
-            break;
-        case 0x8A: // TXA
-            OP_RMW_IMPL(ff(ACC = XREG));
-            break;
-        case 0x8C: // STY, abs
-            OP_WRITE_ABS(YREG);
-            break;
-        case 0x8D: // STA, abs
-            OP_WRITE_ABS(ACC);
-            break;
-        case 0x8E: // STX, abs
-            OP_WRITE_ABS(XREG);
-            break;
-        case 0x90: // BCC
-            OP_BRANCH(!PTEST(PCARRY));
-            break;
-        case 0x91: // STA, (MEM),y
-            OP_WRITE_INDY(ACC);
-            break;
-        case 0x94: // STY, ZP,x
-            OP_WRITE_ZP_IDX(XREG, YREG);
-            break;
-        case 0x95: // STA, ZP,x
-            OP_WRITE_ZP_IDX(XREG, ACC);
-            break;
-        case 0x96: // STX, ZP,y
-            OP_WRITE_ZP_IDX(YREG, XREG);
-            break;
-        case 0x98: // TYA
-            OP_RMW_IMPL(ff(ACC = YREG));
-            break;
-        case 0x99: // STA, MEM,y
-            OP_WRITE_ABS_IDX(YREG, ACC);
-            break;
-        case 0x9A: // TXS
-            OP_RMW_IMPL(SP = XREG); // No flag changes!
-            break;
-        case 0x9D: // STA, MEM,x
-            OP_WRITE_ABS_IDX(XREG, ACC);
-            break;
-        case 0xA0: // LDY, immed.
-            OP_READ_IMM(ff(YREG = val));
-            break;
-        case 0xA1: // LDA, (MEM,x)
-            OP_READ_INDX(ff(ACC = val));
-            break;
-        case 0xA2: // LDX, immed.
-            OP_READ_IMM(ff(XREG = val));
-            break;
-        case 0xA4: // LDY, ZP
-            OP_READ_ZP(ff(YREG = val));
-            break;
-        case 0xA5: // LDA, ZP
-            OP_READ_ZP(ff(ACC = val));
-            break;
-        case 0xA6: // LDX, ZP
-            OP_READ_ZP(ff(XREG = val));
-            break;
-        case 0xA8: // TAY
-            OP_RMW_IMPL(ff(YREG = ACC));
-            break;
-        case 0xA9: // LDA, immed.
-            OP_READ_IMM(ff(ACC = val));
-            break;
-        case 0xAA: // TAX
-            OP_RMW_IMPL(ff(XREG = ACC));
-            break;
-        case 0xAC: // LDY, abs
-            OP_READ_ABS(ff(YREG = val));
-            break;
-        case 0xAD: // LDA, abs
-            OP_READ_ABS(ff(ACC = val));
-            break;
-        case 0xAE: // LDX, abs
-            OP_READ_ABS(ff(XREG = val));
-            break;
-        case 0xB0: // BCS
-            OP_BRANCH(PTEST(PCARRY));
-            break;
-        case 0xB1: // LDA, (MEM),y
-            OP_READ_INDY(ff(ACC = val));
-            break;
-        case 0xB4: // LDY, ZP,x
-            OP_READ_ZP_IDX(XREG, ff(YREG = val));
-            break;
-        case 0xB5: // LDA, ZP,x
-            OP_READ_ZP_IDX(XREG, ff(ACC = val));
-            break;
-        case 0xB6: // LDX, ZP,y
-            OP_READ_ZP_IDX(YREG, ff(XREG = val));
-            break;
-        case 0xB8: // CLV
-            OP_RMW_IMPL(PPUT(POVERFL, 0));
-            break;
-        case 0xB9: // LDA, MEM,y
-            OP_READ_ABS_IDX(YREG, ff(ACC = val));
-            break;
-        case 0xBA: // TSX
-            OP_RMW_IMPL(ff(XREG = SP));
-            break;
-        case 0xBC: // LDY MEM,x
-            OP_READ_ABS_IDX(XREG, ff(YREG = val));
-            break;
-        case 0xBD: // LDA MEM,x
-            OP_READ_ABS_IDX(XREG, ff(ACC = val));
-            break;
-        case 0xBE: // LDX MEM,y
-            OP_READ_ABS_IDX(YREG, ff(XREG = val));
-            break;
-        case 0xC0: // CPY, immed.
-            OP_READ_IMM(do_cmp(YREG, val));
-            break;
-        case 0xC1: // CMP, (MEM,x)
-            OP_READ_INDX(do_cmp(ACC, val));
-            break;
-        case 0xC2: // UNDOCUMENTED: NOP, immed.
-            // Used in BITSY.BOOT. Perhaps to distiguish
-            //  a 65816?
-            OP_READ_IMM();
-            break;
-        case 0xC4: // CPY, ZP
-            OP_READ_ZP(do_cmp(YREG, val));
-            break;
-        case 0xC5: // CMP, ZP
-            OP_READ_ZP(do_cmp(ACC, val));
-            break;
-        case 0xC6: // DEC, ZP
-            OP_RMW_ZP(ff(--val));
-            break;
-        case 0xC8: // INY, impl.
-            OP_RMW_IMPL(ff(++YREG));
-            break;
-        case 0xC9: // CMP, immed.
-            OP_READ_IMM(do_cmp(ACC, val));
-            break;
-        case 0xCA: // DEX, immed.
-            OP_RMW_IMPL(ff(--XREG));
-            break;
-        case 0xCC: // CPY, abs.
-            OP_READ_ABS(do_cmp(YREG, val));
-            break;
-        case 0xCD: // CMP, abs.
-            OP_READ_ABS(do_cmp(ACC, val));
-            break;
-        case 0xCE: // DEC, abs.
-            OP_RMW_ABS(ff(--val));
-            break;
-        case 0xD0: // BNE
-            OP_BRANCH(!PTEST(PZERO));
-            break;
-        case 0xD1: // CMP, (MEM),y
-            OP_READ_INDY(do_cmp(ACC, val));
-            break;
-        case 0xD5: // CMP, ZP,x
-            OP_READ_ZP_IDX(XREG, do_cmp(ACC, val));
-            break;
-        case 0xD6: // DEC, ZP,x
-            OP_RMW_ZP_IDX(XREG, ff(--val));
-            break;
-        case 0xD8: // CLD
-            OP_RMW_IMPL(PPUT(PDEC, 0));
-            break;
-        case 0xD9: // CMP, MEM,y
-            OP_READ_ABS_IDX(YREG, do_cmp(ACC, val));
-            break;
-        case 0xDD: // CMP, MEM,x
-            OP_READ_ABS_IDX(XREG, do_cmp(ACC, val));
-            break;
-        case 0xDE: // DEC, MEM,x
-            OP_RMW_ABS_IDX(XREG, ff(--val));
-            break;
-        case 0xE0: // CPX, immed.
-            OP_READ_IMM(do_cmp(XREG, val));
-            break;
-        case 0xE1: // SBC, (MEM,x)
-            OP_READ_INDX(do_sbc(val));
-            break;
-        case 0xE4: // CPX, ZP
-            OP_READ_ZP(do_cmp(XREG, val));
-            break;
-        case 0xE5: // SBC, ZP
-            OP_READ_ZP(do_sbc(val));
-            break;
-        case 0xE6: // INC, ZP
-            OP_RMW_ZP(ff(++val));
-            break;
-        case 0xE8: // INX (impl.)
-            OP_RMW_IMPL(ff(++XREG));
-            break;
-        case 0xE9: // SBC, immed.
-            OP_READ_IMM(do_sbc(val));
-            break;
-        case 0xEA: // NOP
-            OP_RMW_IMPL(); // empty statement
-            break;
-        case 0xEC: // CPX, abs.
-            OP_READ_ABS(do_cmp(XREG, val));
-            break;
-        case 0xED: // SBC, abs.
-            OP_READ_ABS(do_sbc(val));
-            break;
-        case 0xEE: // INC, abs.
-            OP_RMW_ABS(ff(++val));
-            break;
-        case 0xF0: // BEQ
-            OP_BRANCH(PTEST(PZERO));
-            break;
-        case 0xF1: // SBC, (MEM),y
-            OP_READ_INDY(do_sbc(val));
-            break;
-        case 0xF5: // SBC, ZP,x
-            OP_READ_ZP_IDX(XREG, do_sbc(val));
-            break;
-        case 0xF6: // INC, ZP,x
-            OP_RMW_ZP_IDX(XREG, ff(++val));
-            break;
-        case 0xF8: // SED
-            OP_RMW_IMPL(PPUT(PDEC, 1));
-            break;
-        case 0xF9: // SBC, MEM,y
-            OP_READ_ABS_IDX(YREG, do_sbc(val));
-            break;
-        case 0xFD: // SBC, MEM,x
-            OP_READ_ABS_IDX(XREG, do_sbc(val));
-            break;
-        case 0xFE: // INC, MEM,x
-            OP_RMW_ABS_IDX(XREG, ff(++val));
-            break;
-        case 0x00: // BRK
-            handle_brk_or_illegal(op);
-            break;
-        default:
-            return false; // NOT handled.
-    }
-    return true; // handled.
+/********** 6502 opcodes **********/
+
+// BRK
+static void op_00(byte op, byte immed)
+{
+    handle_brk_or_illegal(op);
 }
 
-void cpu_step(void)
+// ORA, (MEM,x).
+static void op_01(byte op, byte immed)
 {
-    /* Cycle references taken from https://www.nesdev.org/6502_cpu.txt. */
-    byte op = pc_get_adv();
-    cycle(); // end 1
+    OP_READ_INDX(ff(ACC |= val));
+}
 
-    byte immed = peek(PC);
+// ORA, ZP
+static void op_05(byte op, byte immed)
+{
+    OP_READ_ZP(ff(ACC |= val));
+}
 
-    bool handled = false;
-    if (machine_is_enhanced_iie()) {
-        handled = cpu_step_65C02(op, immed);
-    }
-    if (!handled) {
-        handled = cpu_step_6502(op, immed);
-    }
-    if (!handled) {
-        handle_brk_or_illegal(op);
+// ASL, ZP
+static void op_06(byte op, byte immed)
+{
+    OP_RMW_ZP(val = do_asl(val));
+}
+
+// PHP (impl.)
+static void op_08(byte op, byte immed)
+{
+    cycle();
+    stack_push_flags_or(1 << PBRK);
+    cycle();
+}
+
+// ORA, immed.
+static void op_09(byte op, byte immed)
+{
+    OP_READ_IMM(ff(ACC |= immed));
+}
+
+// ASL, impl.
+static void op_0A(byte op, byte immed)
+{
+    OP_RMW_IMPL(ACC = do_asl(ACC));
+}
+
+// ORA, abs
+static void op_0D(byte op, byte immed)
+{
+    OP_READ_ABS(ff(ACC |= val));
+}
+
+// ASL, abs
+static void op_0E(byte op, byte immed)
+{
+    OP_RMW_ABS(val = do_asl(val));
+}
+
+// BPL
+static void op_10(byte op, byte immed)
+{
+    OP_BRANCH(!PTEST(PNEG));
+}
+
+// ORA, (MEM),y
+static void op_11(byte op, byte immed)
+{
+    OP_READ_INDY(ff(ACC |= val));
+}
+
+// ORA, ZP,x
+static void op_15(byte op, byte immed)
+{
+    OP_READ_ZP_IDX(XREG, ff(ACC |= val));
+}
+
+// ASL, ZP,x
+static void op_16(byte op, byte immed)
+{
+    OP_RMW_ZP_IDX(XREG, val = do_asl(val));
+}
+
+// CLC (impl.)
+static void op_18(byte op, byte immed)
+{
+    OP_RMW_IMPL(PPUT(PCARRY, 0));
+}
+
+// ORA, MEM,y
+static void op_19(byte op, byte immed)
+{
+    OP_READ_ABS_IDX(YREG, ff(ACC |= val));
+}
+
+// UNDOCUMENTED nop (when 6502). ProDOS 2.4.2 uses it
+//  to distinguish CPU types...
+//  # cycles/order of ops may be wrong...
+static void op_1A(byte op, byte immed)
+{
+    OP_RMW_IMPL(); // NOP behavior - empty statement
+}
+
+// ORA, MEM,x
+static void op_1D(byte op, byte immed)
+{
+    OP_READ_ABS_IDX(XREG, ff(ACC |= val));
+}
+
+// ASL, MEM,x
+static void op_1E(byte op, byte immed)
+{
+    OP_RMW_ABS_IDX(XREG, val = do_asl(val));
+}
+
+// JSR
+static void op_20(byte op, byte immed)
+{
+    byte lo = immed;
+    PC_ADV;
+    cycle();
+    (void) stack_get();
+    cycle();
+    stack_push(HI(PC));
+    cycle();
+    stack_push(LO(PC));
+    cycle();
+    word dest = WORD(lo, peek(PC));
+    go_to(dest);
+    cycle();
+}
+
+// AND, (MEM,x)
+static void op_21(byte op, byte immed)
+{
+    OP_READ_INDX(ff(ACC &= val));
+}
+
+// BIT, ZP
+static void op_24(byte op, byte immed)
+{
+    OP_READ_ZP(do_bit(val));
+}
+
+// AND, ZP
+static void op_25(byte op, byte immed)
+{
+    OP_READ_ZP(ff(ACC &= val));
+}
+
+// ROL, ZP
+static void op_26(byte op, byte immed)
+{
+    OP_RMW_ZP(val = do_rol(val));
+}
+
+// PLP (impl.)
+static void op_28(byte op, byte immed)
+{
+    cycle();
+    stack_inc();
+    cycle();
+    byte p = peek(STACK);
+    // BRK and UNUSED must always be set; they're not real
+    //  flags (no associated flip flops)
+    PFLAGS = p | PMASK(PUNUSED) | PMASK(PBRK);
+    cycle();
+}
+
+// AND, imm
+static void op_29(byte op, byte immed)
+{
+    OP_READ_IMM(ff(ACC &= val));
+}
+
+// ROL, impl.
+static void op_2A(byte op, byte immed)
+{
+    OP_RMW_IMPL(ACC = do_rol(ACC));
+}
+
+// BIT, abs
+static void op_2C(byte op, byte immed)
+{
+    OP_READ_ABS(do_bit(val));
+}
+
+// AND, abs
+static void op_2D(byte op, byte immed)
+{
+    OP_READ_ABS(ff(ACC &= val));
+}
+
+// ROL, abs
+static void op_2E(byte op, byte immed)
+{
+    OP_RMW_ABS(val = do_rol(val));
+}
+
+// BMI
+static void op_30(byte op, byte immed)
+{
+    OP_BRANCH(PTEST(PNEG));
+}
+
+// AND, (MEM),y
+static void op_31(byte op, byte immed)
+{
+    OP_READ_INDY(ff(ACC &= val));
+}
+
+// AND, ZP,x
+static void op_35(byte op, byte immed)
+{
+    OP_READ_ZP_IDX(XREG, ff(ACC &= val));
+}
+
+// ROL, ZP,x
+static void op_36(byte op, byte immed)
+{
+    OP_RMW_ZP_IDX(XREG, val = do_rol(val));
+}
+
+// SEC (impl.)
+static void op_38(byte op, byte immed)
+{
+    OP_RMW_IMPL(PPUT(PCARRY, 1));
+}
+
+// AND, MEM,y
+static void op_39(byte op, byte immed)
+{
+    OP_READ_ABS_IDX(YREG, ff(ACC &= val));
+}
+
+// On 6502, this is an undocumented NOP instruction
+static void op_3A(byte op, byte immed)
+{
+    OP_RMW_IMPL(); // NOP behavior - empty statement
+}
+
+// AND, MEM,x
+static void op_3D(byte op, byte immed)
+{
+    OP_READ_ABS_IDX(XREG, ff(ACC &= val));
+}
+
+// ROL, MEM,x
+static void op_3E(byte op, byte immed)
+{
+    OP_RMW_ABS_IDX(XREG, val = do_rol(val));
+}
+
+// RTI
+static void op_40(byte op, byte immed)
+{
+    cycle(); // end 2
+    byte p = stack_pop();
+    cycle(); // 3
+    PFLAGS = (p & 0xCF) | PMASK(PUNUSED);
+    byte lo = stack_pop();
+    cycle(); // 4
+    go_to(WORD(lo, HI(PC)));
+    byte hi = stack_pop();
+    cycle(); // 5
+    go_to(WORD(lo, hi));
+    (void) peek(STACK);
+    cycle(); // 6
+}
+
+// EOR, (MEM,x)
+static void op_41(byte op, byte immed)
+{
+    OP_READ_INDX(ff(ACC ^= val));
+}
+
+// EOR, ZP
+static void op_45(byte op, byte immed)
+{
+    OP_READ_ZP(ff(ACC ^= val));
+}
+
+// LSR, ZP
+static void op_46(byte op, byte immed)
+{
+    OP_RMW_ZP(val = do_lsr(val));
+}
+
+// PHA
+static void op_48(byte op, byte immed)
+{
+    cycle();
+    stack_push(ACC);
+    cycle();
+}
+
+// EOR, imm
+static void op_49(byte op, byte immed)
+{
+    OP_READ_IMM(ff(ACC ^= val));
+}
+
+// LSR, impl.
+static void op_4A(byte op, byte immed)
+{
+    OP_RMW_IMPL(ACC = do_lsr(ACC));
+}
+
+// JMP
+static void op_4C(byte op, byte immed)
+{
+    byte lo = immed;
+    PC_ADV;
+    cycle();
+    byte hi = pc_get_adv();
+    word dest = WORD(lo, hi);
+    go_to(dest);
+    cycle();
+}
+
+// EOR, abs
+static void op_4D(byte op, byte immed)
+{
+    OP_READ_ABS(ff(ACC ^= val));
+}
+
+// LSR, abs
+static void op_4E(byte op, byte immed)
+{
+    OP_RMW_ABS(val = do_lsr(val));
+}
+
+// BVC
+static void op_50(byte op, byte immed)
+{
+    OP_BRANCH(!PTEST(POVERFL));
+}
+
+// EOR, (MEM),y
+static void op_51(byte op, byte immed)
+{
+    OP_READ_INDY(ff(ACC ^= val));
+}
+
+// EOR, ZP,x
+static void op_55(byte op, byte immed)
+{
+    OP_READ_ZP_IDX(XREG, ff(ACC ^= val));
+}
+
+// LSR, ZP,x
+static void op_56(byte op, byte immed)
+{
+    OP_RMW_ZP_IDX(XREG, val = do_lsr(val));
+}
+
+// CLI
+static void op_58(byte op, byte immed)
+{
+    OP_RMW_IMPL(PPUT(PINT, 0));
+}
+
+// EOR, MEM,y
+static void op_59(byte op, byte immed)
+{
+    OP_READ_ABS_IDX(YREG, ff(ACC ^= val));
+}
+
+// EOR, MEM,x
+static void op_5D(byte op, byte immed)
+{
+    OP_READ_ABS_IDX(XREG, ff(ACC ^= val));
+}
+
+// LSR, MEM,x
+static void op_5E(byte op, byte immed)
+{
+    OP_RMW_ABS_IDX(XREG, val = do_lsr(val));
+}
+
+// RTS
+static void op_60(byte op, byte immed)
+{
+    word orig = PC;
+    cycle(); // end 2
+    byte lo = stack_pop();
+    cycle(); // 3
+    go_to(WORD(lo, HI(PC)));
+    (void) stack_pop();
+    cycle(); // 4
+    byte hi = peek(STACK);
+    word dest = WORD(lo, hi);
+    go_to(dest);
+    cycle(); // 5
+    PC_ADV;
+    cycle(); // 6
+}
+
+// ADC, (MEM,x)
+static void op_61(byte op, byte immed)
+{
+    OP_READ_INDX(do_adc(val));
+}
+
+// ADC, ZP
+static void op_65(byte op, byte immed)
+{
+    OP_READ_ZP(do_adc(val));
+}
+
+// ROR, ZP
+static void op_66(byte op, byte immed)
+{
+    OP_RMW_ZP(val = do_ror(val));
+}
+
+// PLA
+static void op_68(byte op, byte immed)
+{
+    cycle();
+    (void) stack_pop();
+    cycle();
+    ff(ACC = peek(STACK));
+    cycle();
+}
+
+// ADC, imm
+static void op_69(byte op, byte immed)
+{
+    OP_READ_IMM(do_adc(val));
+}
+
+// ROR, impl.
+static void op_6A(byte op, byte immed)
+{
+    OP_RMW_IMPL(ACC = do_ror(ACC));
+}
+
+// JMP ()
+static void op_6C(byte op, byte immed)
+{
+    byte lo = immed;
+    PC_ADV;
+    cycle(); // 2
+    byte hi = pc_get_adv();
+    word addr = WORD(lo,hi);
+    cycle(); // 3
+    lo = peek(addr);
+    cycle(); // 4
+    // 6502 page-crossing BUG!!
+    hi = peek(WORD(LO(addr+1),HI(addr)));
+    word dest = WORD(lo, hi);
+    go_to(dest);
+    cycle(); // 5
+}
+
+// ADC, abs
+static void op_6D(byte op, byte immed)
+{
+    OP_READ_ABS(do_adc(val));
+}
+
+// ROR, abs
+static void op_6E(byte op, byte immed)
+{
+    OP_RMW_ABS(val = do_ror(val));
+}
+
+// BVS
+static void op_70(byte op, byte immed)
+{
+    OP_BRANCH(PTEST(POVERFL));
+}
+
+// ADC, (MEM),y
+static void op_71(byte op, byte immed)
+{
+    OP_READ_INDY(do_adc(val));
+}
+
+// ADC, ZP,x
+static void op_75(byte op, byte immed)
+{
+    OP_READ_ZP_IDX(XREG, do_adc(val));
+}
+
+// ROR, ZP,x
+static void op_76(byte op, byte immed)
+{
+    OP_RMW_ZP_IDX(XREG, val = do_ror(val));
+}
+
+// SEI
+static void op_78(byte op, byte immed)
+{
+    OP_RMW_IMPL(PPUT(PINT, 1));
+}
+
+// ADC MEM,y
+static void op_79(byte op, byte immed)
+{
+    OP_READ_ABS_IDX(YREG, do_adc(val));
+}
+
+// ADC, MEM,x
+static void op_7D(byte op, byte immed)
+{
+    OP_READ_ABS_IDX(XREG, do_adc(val));
+}
+
+// ROR, MEM,x
+static void op_7E(byte op, byte immed)
+{
+    OP_RMW_ABS_IDX(XREG, val = do_ror(val));
+}
+
+// STA, (MEM,x)
+static void op_81(byte op, byte immed)
+{
+    OP_WRITE_INDX(ACC);
+}
+
+// STY, ZP
+static void op_84(byte op, byte immed)
+{
+    OP_WRITE_ZP(YREG);
+}
+
+// STA, ZP
+static void op_85(byte op, byte immed)
+{
+    OP_WRITE_ZP(ACC);
+}
+
+// STX, ZP
+static void op_86(byte op, byte immed)
+{
+    OP_WRITE_ZP(XREG);
+}
+
+// DEY
+static void op_88(byte op, byte immed)
+{
+    OP_RMW_IMPL(ff(--YREG));
+}
+
+// TXA
+static void op_8A(byte op, byte immed)
+{
+    OP_RMW_IMPL(ff(ACC = XREG));
+}
+
+// STY, abs
+static void op_8C(byte op, byte immed)
+{
+    OP_WRITE_ABS(YREG);
+}
+
+// STA, abs
+static void op_8D(byte op, byte immed)
+{
+    OP_WRITE_ABS(ACC);
+}
+
+// STX, abs
+static void op_8E(byte op, byte immed)
+{
+    OP_WRITE_ABS(XREG);
+}
+
+// BCC
+static void op_90(byte op, byte immed)
+{
+    OP_BRANCH(!PTEST(PCARRY));
+}
+
+// STA, (MEM),y
+static void op_91(byte op, byte immed)
+{
+    OP_WRITE_INDY(ACC);
+}
+
+// STY, ZP,x
+static void op_94(byte op, byte immed)
+{
+    OP_WRITE_ZP_IDX(XREG, YREG);
+}
+
+// STA, ZP,x
+static void op_95(byte op, byte immed)
+{
+    OP_WRITE_ZP_IDX(XREG, ACC);
+}
+
+// STX, ZP,y
+static void op_96(byte op, byte immed)
+{
+    OP_WRITE_ZP_IDX(YREG, XREG);
+}
+
+// TYA
+static void op_98(byte op, byte immed)
+{
+    OP_RMW_IMPL(ff(ACC = YREG));
+}
+
+// STA, MEM,y
+static void op_99(byte op, byte immed)
+{
+    OP_WRITE_ABS_IDX(YREG, ACC);
+}
+
+// TXS
+static void op_9A(byte op, byte immed)
+{
+    OP_RMW_IMPL(SP = XREG); // No flag changes!
+}
+
+// STA, MEM,x
+static void op_9D(byte op, byte immed)
+{
+    OP_WRITE_ABS_IDX(XREG, ACC);
+}
+
+// LDY, immed.
+static void op_A0(byte op, byte immed)
+{
+    OP_READ_IMM(ff(YREG = val));
+}
+
+// LDA, (MEM,x)
+static void op_A1(byte op, byte immed)
+{
+    OP_READ_INDX(ff(ACC = val));
+}
+
+// LDX, immed.
+static void op_A2(byte op, byte immed)
+{
+    OP_READ_IMM(ff(XREG = val));
+}
+
+// LDY, ZP
+static void op_A4(byte op, byte immed)
+{
+    OP_READ_ZP(ff(YREG = val));
+}
+
+// LDA, ZP
+static void op_A5(byte op, byte immed)
+{
+    OP_READ_ZP(ff(ACC = val));
+}
+
+// LDX, ZP
+static void op_A6(byte op, byte immed)
+{
+    OP_READ_ZP(ff(XREG = val));
+}
+
+// TAY
+static void op_A8(byte op, byte immed)
+{
+    OP_RMW_IMPL(ff(YREG = ACC));
+}
+
+// LDA, immed.
+static void op_A9(byte op, byte immed)
+{
+    OP_READ_IMM(ff(ACC = val));
+}
+
+// TAX
+static void op_AA(byte op, byte immed)
+{
+    OP_RMW_IMPL(ff(XREG = ACC));
+}
+
+// LDY, abs
+static void op_AC(byte op, byte immed)
+{
+    OP_READ_ABS(ff(YREG = val));
+}
+
+// LDA, abs
+static void op_AD(byte op, byte immed)
+{
+    OP_READ_ABS(ff(ACC = val));
+}
+
+// LDX, abs
+static void op_AE(byte op, byte immed)
+{
+    OP_READ_ABS(ff(XREG = val));
+}
+
+// BCS
+static void op_B0(byte op, byte immed)
+{
+    OP_BRANCH(PTEST(PCARRY));
+}
+
+// LDA, (MEM),y
+static void op_B1(byte op, byte immed)
+{
+    OP_READ_INDY(ff(ACC = val));
+}
+
+// LDY, ZP,x
+static void op_B4(byte op, byte immed)
+{
+    OP_READ_ZP_IDX(XREG, ff(YREG = val));
+}
+
+// LDA, ZP,x
+static void op_B5(byte op, byte immed)
+{
+    OP_READ_ZP_IDX(XREG, ff(ACC = val));
+}
+
+// LDX, ZP,y
+static void op_B6(byte op, byte immed)
+{
+    OP_READ_ZP_IDX(YREG, ff(XREG = val));
+}
+
+// CLV
+static void op_B8(byte op, byte immed)
+{
+    OP_RMW_IMPL(PPUT(POVERFL, 0));
+}
+
+// LDA, MEM,y
+static void op_B9(byte op, byte immed)
+{
+    OP_READ_ABS_IDX(YREG, ff(ACC = val));
+}
+
+// TSX
+static void op_BA(byte op, byte immed)
+{
+    OP_RMW_IMPL(ff(XREG = SP));
+}
+
+// LDY MEM,x
+static void op_BC(byte op, byte immed)
+{
+    OP_READ_ABS_IDX(XREG, ff(YREG = val));
+}
+
+// LDA MEM,x
+static void op_BD(byte op, byte immed)
+{
+    OP_READ_ABS_IDX(XREG, ff(ACC = val));
+}
+
+// LDX MEM,y
+static void op_BE(byte op, byte immed)
+{
+    OP_READ_ABS_IDX(YREG, ff(XREG = val));
+}
+
+// CPY, immed.
+static void op_C0(byte op, byte immed)
+{
+    OP_READ_IMM(do_cmp(YREG, val));
+}
+
+// CMP, (MEM,x)
+static void op_C1(byte op, byte immed)
+{
+    OP_READ_INDX(do_cmp(ACC, val));
+}
+
+// UNDOCUMENTED: NOP, immed.
+static void op_C2(byte op, byte immed)
+{
+    // Used in BITSY.BOOT. Perhaps to distiguish
+    //  a 65816?
+    OP_READ_IMM();
+}
+
+// CPY, ZP
+static void op_C4(byte op, byte immed)
+{
+    OP_READ_ZP(do_cmp(YREG, val));
+}
+
+// CMP, ZP
+static void op_C5(byte op, byte immed)
+{
+    OP_READ_ZP(do_cmp(ACC, val));
+}
+
+// DEC, ZP
+static void op_C6(byte op, byte immed)
+{
+    OP_RMW_ZP(ff(--val));
+}
+
+// INY, impl.
+static void op_C8(byte op, byte immed)
+{
+    OP_RMW_IMPL(ff(++YREG));
+}
+
+// CMP, immed.
+static void op_C9(byte op, byte immed)
+{
+    OP_READ_IMM(do_cmp(ACC, val));
+}
+
+// DEX, immed.
+static void op_CA(byte op, byte immed)
+{
+    OP_RMW_IMPL(ff(--XREG));
+}
+
+// CPY, abs.
+static void op_CC(byte op, byte immed)
+{
+    OP_READ_ABS(do_cmp(YREG, val));
+}
+
+// CMP, abs.
+static void op_CD(byte op, byte immed)
+{
+    OP_READ_ABS(do_cmp(ACC, val));
+}
+
+// DEC, abs.
+static void op_CE(byte op, byte immed)
+{
+    OP_RMW_ABS(ff(--val));
+}
+
+// BNE
+static void op_D0(byte op, byte immed)
+{
+    OP_BRANCH(!PTEST(PZERO));
+}
+
+// CMP, (MEM),y
+static void op_D1(byte op, byte immed)
+{
+    OP_READ_INDY(do_cmp(ACC, val));
+}
+
+// CMP, ZP,x
+static void op_D5(byte op, byte immed)
+{
+    OP_READ_ZP_IDX(XREG, do_cmp(ACC, val));
+}
+
+// DEC, ZP,x
+static void op_D6(byte op, byte immed)
+{
+    OP_RMW_ZP_IDX(XREG, ff(--val));
+}
+
+// CLD
+static void op_D8(byte op, byte immed)
+{
+    OP_RMW_IMPL(PPUT(PDEC, 0));
+}
+
+// CMP, MEM,y
+static void op_D9(byte op, byte immed)
+{
+    OP_READ_ABS_IDX(YREG, do_cmp(ACC, val));
+}
+
+// CMP, MEM,x
+static void op_DD(byte op, byte immed)
+{
+    OP_READ_ABS_IDX(XREG, do_cmp(ACC, val));
+}
+
+// DEC, MEM,x
+static void op_DE(byte op, byte immed)
+{
+    OP_RMW_ABS_IDX(XREG, ff(--val));
+}
+
+// CPX, immed.
+static void op_E0(byte op, byte immed)
+{
+    OP_READ_IMM(do_cmp(XREG, val));
+}
+
+// SBC, (MEM,x)
+static void op_E1(byte op, byte immed)
+{
+    OP_READ_INDX(do_sbc(val));
+}
+
+// CPX, ZP
+static void op_E4(byte op, byte immed)
+{
+    OP_READ_ZP(do_cmp(XREG, val));
+}
+
+// SBC, ZP
+static void op_E5(byte op, byte immed)
+{
+    OP_READ_ZP(do_sbc(val));
+}
+
+// INC, ZP
+static void op_E6(byte op, byte immed)
+{
+    OP_RMW_ZP(ff(++val));
+}
+
+// INX (impl.)
+static void op_E8(byte op, byte immed)
+{
+    OP_RMW_IMPL(ff(++XREG));
+}
+
+// SBC, immed.
+static void op_E9(byte op, byte immed)
+{
+    OP_READ_IMM(do_sbc(val));
+}
+
+// NOP
+static void op_EA(byte op, byte immed)
+{
+    OP_RMW_IMPL(); // empty statement
+}
+
+// CPX, abs.
+static void op_EC(byte op, byte immed)
+{
+    OP_READ_ABS(do_cmp(XREG, val));
+}
+
+// SBC, abs.
+static void op_ED(byte op, byte immed)
+{
+    OP_READ_ABS(do_sbc(val));
+}
+
+// INC, abs.
+static void op_EE(byte op, byte immed)
+{
+    OP_RMW_ABS(ff(++val));
+}
+
+// BEQ
+static void op_F0(byte op, byte immed)
+{
+    OP_BRANCH(PTEST(PZERO));
+}
+
+// SBC, (MEM),y
+static void op_F1(byte op, byte immed)
+{
+    OP_READ_INDY(do_sbc(val));
+}
+
+// SBC, ZP,x
+static void op_F5(byte op, byte immed)
+{
+    OP_READ_ZP_IDX(XREG, do_sbc(val));
+}
+
+// INC, ZP,x
+static void op_F6(byte op, byte immed)
+{
+    OP_RMW_ZP_IDX(XREG, ff(++val));
+}
+
+// SED
+static void op_F8(byte op, byte immed)
+{
+    OP_RMW_IMPL(PPUT(PDEC, 1));
+}
+
+// SBC, MEM,y
+static void op_F9(byte op, byte immed)
+{
+    OP_READ_ABS_IDX(YREG, do_sbc(val));
+}
+
+// SBC, MEM,x
+static void op_FD(byte op, byte immed)
+{
+    OP_READ_ABS_IDX(XREG, do_sbc(val));
+}
+
+// INC, MEM,x
+static void op_FE(byte op, byte immed)
+{
+    OP_RMW_ABS_IDX(XREG, ff(++val));
+}
+
+
+/********** 65C02 opcodes **********/
+
+// Opcodes that are new in the 65C02, or that behave differently
+// from the 6502's.
+
+// TSB zp - Test and Set Bits, Zero Page (MOS 65C02 only)
+static void op_c02_04(byte op, byte immed)
+{
+    OP_RMW_ZP(
+        PPUT(PZERO, (val & ACC) == 0);
+        val |= ACC;
+    );
+}
+
+// TSB abs - Test and Set Bits, Absolute (MOS 65C02 only)
+static void op_c02_0C(byte op, byte immed)
+{
+    OP_RMW_ABS(
+        PPUT(PZERO, (val & ACC) == 0);
+        val |= ACC;
+    );
+}
+
+// ORA (zp) - OR with Accumulator, Zero Page Indirect (MOS 65C02 only)
+static void op_c02_12(byte op, byte immed)
+{
+    byte zp_addr = immed;
+    PC_ADV;
+    cycle();
+    byte lo = peek(zp_addr);
+    cycle();
+    byte hi = peek((zp_addr + 1) & 0xFF);
+    cycle();
+    byte val = peek(WORD(lo, hi));
+    ff(ACC |= val);
+    cycle();
+}
+
+// TRB zp - Test and Reset Bits, Zero Page (MOS 65C02 only)
+static void op_c02_14(byte op, byte immed)
+{
+    OP_RMW_ZP(
+        PPUT(PZERO, (val & ACC) == 0);
+        val &= ~ACC;
+    );
+}
+
+// INC A (MOS 65C02) / NOP (6502) - ProDOS 2.4.2 uses this to distinguish CPU types
+static void op_c02_1A(byte op, byte immed)
+{
+    OP_RMW_IMPL(ff(++ACC));
+}
+
+// TRB abs - Test and Reset Bits, Absolute (MOS 65C02 only)
+static void op_c02_1C(byte op, byte immed)
+{
+    OP_RMW_ABS(
+        PPUT(PZERO, (val & ACC) == 0);
+        val &= ~ACC;
+    );
+}
+
+// AND (zp) - AND with Accumulator, Zero Page Indirect (MOS 65C02 only)
+static void op_c02_32(byte op, byte immed)
+{
+    byte zp_addr = immed;
+    PC_ADV;
+    cycle();
+    byte lo = peek(zp_addr);
+    cycle();
+    byte hi = peek((zp_addr + 1) & 0xFF);
+    cycle();
+    byte val = peek(WORD(lo, hi));
+    ff(ACC &= val);
+    cycle();
+}
+
+// BIT zp,X - BIT Zero Page,X (MOS 65C02 only)
+static void op_c02_34(byte op, byte immed)
+{
+    OP_READ_ZP_IDX(XREG, do_bit(val));
+}
+
+// DEC A (MOS 65C02) / NOP (6502)
+static void op_c02_3A(byte op, byte immed)
+{
+    OP_RMW_IMPL(ff(--ACC));
+}
+
+// BIT abs,X - BIT Absolute,X (MOS 65C02 only)
+static void op_c02_3C(byte op, byte immed)
+{
+    OP_READ_ABS_IDX(XREG, do_bit(val));
+}
+
+// EOR (zp) - Exclusive OR, Zero Page Indirect (MOS 65C02 only)
+static void op_c02_52(byte op, byte immed)
+{
+    byte zp_addr = immed;
+    PC_ADV;
+    cycle();
+    byte lo = peek(zp_addr);
+    cycle();
+    byte hi = peek((zp_addr + 1) & 0xFF);
+    cycle();
+    byte val = peek(WORD(lo, hi));
+    ff(ACC ^= val);
+    cycle();
+}
+
+// PHY (Push Y) - MOS 65C02 only
+static void op_c02_5A(byte op, byte immed)
+{
+    cycle();
+    stack_push(YREG);
+    cycle();
+}
+
+// STZ zp - Store Zero, Zero Page (MOS 65C02 only)
+static void op_c02_64(byte op, byte immed)
+{
+    OP_WRITE_ZP(0);
+}
+
+// JMP () - without the 6502's page-crossing bug
+static void op_c02_6C(byte op, byte immed)
+{
+    byte lo = immed;
+    PC_ADV;
+    cycle(); // 2
+    byte hi = pc_get_adv();
+    word addr = WORD(lo,hi);
+    cycle(); // 3
+    lo = peek(addr);
+    cycle(); // 4
+    hi = peek(addr+1);
+    word dest = WORD(lo, hi);
+    go_to(dest);
+    cycle(); // 5
+}
+
+// ADC (zp) - Add with Carry, Zero Page Indirect (MOS 65C02 only)
+static void op_c02_72(byte op, byte immed)
+{
+    byte zp_addr = immed;
+    PC_ADV;
+    cycle();
+    byte lo = peek(zp_addr);
+    cycle();
+    byte hi = peek((zp_addr + 1) & 0xFF);
+    cycle();
+    byte val = peek(WORD(lo, hi));
+    do_adc(val);
+    cycle();
+}
+
+// STZ zp,X - Store Zero, Zero Page,X (MOS 65C02 only)
+static void op_c02_74(byte op, byte immed)
+{
+    OP_WRITE_ZP_IDX(XREG, 0);
+}
+
+// PLY (Pull Y) - MOS 65C02 only
+static void op_c02_7A(byte op, byte immed)
+{
+    cycle();
+    stack_inc();
+    cycle();
+    YREG = peek(STACK);
+    ff(YREG);
+    cycle();
+}
+
+// JMP (abs,X) - Jump Absolute Indirect Indexed (MOS 65C02 only)
+static void op_c02_7C(byte op, byte immed)
+{
+    byte lo = immed;
+    PC_ADV;
+    cycle();
+    byte hi = pc_get_adv();
+    cycle();
+    word base_addr = WORD(lo, hi);
+    word addr = base_addr + XREG;
+    cycle();
+    lo = peek(addr);
+    cycle();
+    hi = peek(addr + 1);
+    word dest = WORD(lo, hi);
+    go_to(dest);
+    cycle();
+}
+
+// BRA (Branch Always) - MOS 65C02 only
+static void op_c02_80(byte op, byte immed)
+{
+    OP_BRANCH(true);
+}
+
+// BIT #imm - BIT Immediate (MOS 65C02 only)
+static void op_c02_89(byte op, byte immed)
+{
+    OP_READ_IMM(PPUT(PZERO, (ACC & val) == 0));
+}
+
+// STA (zp) - Store Accumulator, Zero Page Indirect (MOS 65C02 only)
+static void op_c02_92(byte op, byte immed)
+{
+    byte zp_addr = immed;
+    PC_ADV;
+    cycle();
+    byte lo = peek(zp_addr);
+    cycle();
+    byte hi = peek((zp_addr + 1) & 0xFF);
+    cycle();
+    poke(WORD(lo, hi), ACC);
+    cycle();
+}
+
+// STZ abs - Store Zero, Absolute (MOS 65C02 only)
+static void op_c02_9C(byte op, byte immed)
+{
+    OP_WRITE_ABS(0);
+}
+
+// STZ abs,X - Store Zero, Absolute,X (MOS 65C02 only)
+static void op_c02_9E(byte op, byte immed)
+{
+    OP_WRITE_ABS_IDX(XREG, 0);
+}
+
+// LDA (zp) - Load Accumulator, Zero Page Indirect (MOS 65C02 only)
+static void op_c02_B2(byte op, byte immed)
+{
+    byte zp_addr = immed;
+    PC_ADV;
+    cycle();
+    byte lo = peek(zp_addr);
+    cycle();
+    byte hi = peek((zp_addr + 1) & 0xFF);
+    cycle();
+    byte val = peek(WORD(lo, hi));
+    ff(ACC = val);
+    cycle();
+}
+
+// CMP, (ZP)
+static void op_c02_D2(byte op, byte immed)
+{
+    byte zp_addr = immed;
+    PC_ADV;
+    cycle();
+    byte lo = peek(zp_addr);
+    cycle();
+    byte hi = peek((zp_addr + 1) & 0xFF);
+    cycle();
+    byte val = peek(WORD(lo, hi));
+    do_cmp(ACC, val);
+    cycle();
+}
+
+// PHX (Push X) - MOS 65C02 only
+static void op_c02_DA(byte op, byte immed)
+{
+    cycle();
+    stack_push(XREG);
+    cycle();
+}
+
+// SBC (zp) - Subtract with Borrow, Zero Page Indirect (MOS 65C02 only)
+static void op_c02_F2(byte op, byte immed)
+{
+    byte zp_addr = immed;
+    PC_ADV;
+    cycle();
+    byte lo = peek(zp_addr);
+    cycle();
+    byte hi = peek((zp_addr + 1) & 0xFF);
+    cycle();
+    byte val = peek(WORD(lo, hi));
+    do_sbc(val);
+    cycle();
+}
+
+// PLX (Pull X) - MOS 65C02 only
+static void op_c02_FA(byte op, byte immed)
+{
+    cycle();
+    stack_inc();
+    cycle();
+    XREG = peek(STACK);
+    ff(XREG);
+    cycle();
+}
+
+// Unrecognized opcode (treat as BRK)
+static void op_illegal(byte op, byte immed)
+{
+    handle_brk_or_illegal(op);
+}
+
+/********** Dispatch tables **********/
+
+static OpHandler optable_6502[256] = {
+    [0x00] = op_00,
+    [0x01] = op_01,
+    [0x05] = op_05,
+    [0x06] = op_06,
+    [0x08] = op_08,
+    [0x09] = op_09,
+    [0x0A] = op_0A,
+    [0x0D] = op_0D,
+    [0x0E] = op_0E,
+    [0x10] = op_10,
+    [0x11] = op_11,
+    [0x15] = op_15,
+    [0x16] = op_16,
+    [0x18] = op_18,
+    [0x19] = op_19,
+    [0x1A] = op_1A,
+    [0x1D] = op_1D,
+    [0x1E] = op_1E,
+    [0x20] = op_20,
+    [0x21] = op_21,
+    [0x24] = op_24,
+    [0x25] = op_25,
+    [0x26] = op_26,
+    [0x28] = op_28,
+    [0x29] = op_29,
+    [0x2A] = op_2A,
+    [0x2C] = op_2C,
+    [0x2D] = op_2D,
+    [0x2E] = op_2E,
+    [0x30] = op_30,
+    [0x31] = op_31,
+    [0x35] = op_35,
+    [0x36] = op_36,
+    [0x38] = op_38,
+    [0x39] = op_39,
+    [0x3A] = op_3A,
+    [0x3D] = op_3D,
+    [0x3E] = op_3E,
+    [0x40] = op_40,
+    [0x41] = op_41,
+    [0x45] = op_45,
+    [0x46] = op_46,
+    [0x48] = op_48,
+    [0x49] = op_49,
+    [0x4A] = op_4A,
+    [0x4C] = op_4C,
+    [0x4D] = op_4D,
+    [0x4E] = op_4E,
+    [0x50] = op_50,
+    [0x51] = op_51,
+    [0x55] = op_55,
+    [0x56] = op_56,
+    [0x58] = op_58,
+    [0x59] = op_59,
+    [0x5D] = op_5D,
+    [0x5E] = op_5E,
+    [0x60] = op_60,
+    [0x61] = op_61,
+    [0x65] = op_65,
+    [0x66] = op_66,
+    [0x68] = op_68,
+    [0x69] = op_69,
+    [0x6A] = op_6A,
+    [0x6C] = op_6C,
+    [0x6D] = op_6D,
+    [0x6E] = op_6E,
+    [0x70] = op_70,
+    [0x71] = op_71,
+    [0x75] = op_75,
+    [0x76] = op_76,
+    [0x78] = op_78,
+    [0x79] = op_79,
+    [0x7D] = op_7D,
+    [0x7E] = op_7E,
+    [0x81] = op_81,
+    [0x84] = op_84,
+    [0x85] = op_85,
+    [0x86] = op_86,
+    [0x88] = op_88,
+    [0x8A] = op_8A,
+    [0x8C] = op_8C,
+    [0x8D] = op_8D,
+    [0x8E] = op_8E,
+    [0x90] = op_90,
+    [0x91] = op_91,
+    [0x94] = op_94,
+    [0x95] = op_95,
+    [0x96] = op_96,
+    [0x98] = op_98,
+    [0x99] = op_99,
+    [0x9A] = op_9A,
+    [0x9D] = op_9D,
+    [0xA0] = op_A0,
+    [0xA1] = op_A1,
+    [0xA2] = op_A2,
+    [0xA4] = op_A4,
+    [0xA5] = op_A5,
+    [0xA6] = op_A6,
+    [0xA8] = op_A8,
+    [0xA9] = op_A9,
+    [0xAA] = op_AA,
+    [0xAC] = op_AC,
+    [0xAD] = op_AD,
+    [0xAE] = op_AE,
+    [0xB0] = op_B0,
+    [0xB1] = op_B1,
+    [0xB4] = op_B4,
+    [0xB5] = op_B5,
+    [0xB6] = op_B6,
+    [0xB8] = op_B8,
+    [0xB9] = op_B9,
+    [0xBA] = op_BA,
+    [0xBC] = op_BC,
+    [0xBD] = op_BD,
+    [0xBE] = op_BE,
+    [0xC0] = op_C0,
+    [0xC1] = op_C1,
+    [0xC2] = op_C2,
+    [0xC4] = op_C4,
+    [0xC5] = op_C5,
+    [0xC6] = op_C6,
+    [0xC8] = op_C8,
+    [0xC9] = op_C9,
+    [0xCA] = op_CA,
+    [0xCC] = op_CC,
+    [0xCD] = op_CD,
+    [0xCE] = op_CE,
+    [0xD0] = op_D0,
+    [0xD1] = op_D1,
+    [0xD5] = op_D5,
+    [0xD6] = op_D6,
+    [0xD8] = op_D8,
+    [0xD9] = op_D9,
+    [0xDD] = op_DD,
+    [0xDE] = op_DE,
+    [0xE0] = op_E0,
+    [0xE1] = op_E1,
+    [0xE4] = op_E4,
+    [0xE5] = op_E5,
+    [0xE6] = op_E6,
+    [0xE8] = op_E8,
+    [0xE9] = op_E9,
+    [0xEA] = op_EA,
+    [0xEC] = op_EC,
+    [0xED] = op_ED,
+    [0xEE] = op_EE,
+    [0xF0] = op_F0,
+    [0xF1] = op_F1,
+    [0xF5] = op_F5,
+    [0xF6] = op_F6,
+    [0xF8] = op_F8,
+    [0xF9] = op_F9,
+    [0xFD] = op_FD,
+    [0xFE] = op_FE,
+};
+
+static const OpHandler ops_65C02[256] = {
+    [0x04] = op_c02_04,
+    [0x0C] = op_c02_0C,
+    [0x12] = op_c02_12,
+    [0x14] = op_c02_14,
+    [0x1A] = op_c02_1A,
+    [0x1C] = op_c02_1C,
+    [0x32] = op_c02_32,
+    [0x34] = op_c02_34,
+    [0x3A] = op_c02_3A,
+    [0x3C] = op_c02_3C,
+    [0x52] = op_c02_52,
+    [0x5A] = op_c02_5A,
+    [0x64] = op_c02_64,
+    [0x6C] = op_c02_6C,
+    [0x72] = op_c02_72,
+    [0x74] = op_c02_74,
+    [0x7A] = op_c02_7A,
+    [0x7C] = op_c02_7C,
+    [0x80] = op_c02_80,
+    [0x89] = op_c02_89,
+    [0x92] = op_c02_92,
+    [0x9C] = op_c02_9C,
+    [0x9E] = op_c02_9E,
+    [0xB2] = op_c02_B2,
+    [0xD2] = op_c02_D2,
+    [0xDA] = op_c02_DA,
+    [0xF2] = op_c02_F2,
+    [0xFA] = op_c02_FA,
+};
+
+static OpHandler optable_65C02[256];
+
+static const OpHandler *optable = optable_6502;
+
+/* Fixed cycle cost of each opcode: every cycle, including the opcode
+   fetch, that its handler counts no matter what (so, not counting
+   cycle_extra()s). Only used with --enable-batched-cycles; these
+   must be kept in sync with the handlers above. */
+static byte cycles_6502[256] = {
+    [0x00] = 1,
+    [0x01] = 6,
+    [0x05] = 3,
+    [0x06] = 5,
+    [0x08] = 3,
+    [0x09] = 2,
+    [0x0A] = 2,
+    [0x0D] = 4,
+    [0x0E] = 6,
+    [0x10] = 3,
+    [0x11] = 5,
+    [0x15] = 3,
+    [0x16] = 6,
+    [0x18] = 2,
+    [0x19] = 3,
+    [0x1A] = 2,
+    [0x1D] = 3,
+    [0x1E] = 7,
+    [0x20] = 6,
+    [0x21] = 6,
+    [0x24] = 3,
+    [0x25] = 3,
+    [0x26] = 5,
+    [0x28] = 4,
+    [0x29] = 2,
+    [0x2A] = 2,
+    [0x2C] = 4,
+    [0x2D] = 4,
+    [0x2E] = 6,
+    [0x30] = 3,
+    [0x31] = 5,
+    [0x35] = 3,
+    [0x36] = 6,
+    [0x38] = 2,
+    [0x39] = 3,
+    [0x3A] = 2,
+    [0x3D] = 3,
+    [0x3E] = 7,
+    [0x40] = 6,
+    [0x41] = 6,
+    [0x45] = 3,
+    [0x46] = 5,
+    [0x48] = 3,
+    [0x49] = 2,
+    [0x4A] = 2,
+    [0x4C] = 3,
+    [0x4D] = 4,
+    [0x4E] = 6,
+    [0x50] = 3,
+    [0x51] = 5,
+    [0x55] = 3,
+    [0x56] = 6,
+    [0x58] = 2,
+    [0x59] = 3,
+    [0x5D] = 3,
+    [0x5E] = 7,
+    [0x60] = 6,
+    [0x61] = 6,
+    [0x65] = 3,
+    [0x66] = 5,
+    [0x68] = 4,
+    [0x69] = 2,
+    [0x6A] = 2,
+    [0x6C] = 5,
+    [0x6D] = 4,
+    [0x6E] = 6,
+    [0x70] = 3,
+    [0x71] = 5,
+    [0x75] = 3,
+    [0x76] = 6,
+    [0x78] = 2,
+    [0x79] = 3,
+    [0x7D] = 3,
+    [0x7E] = 7,
+    [0x81] = 6,
+    [0x84] = 3,
+    [0x85] = 3,
+    [0x86] = 3,
+    [0x88] = 2,
+    [0x8A] = 2,
+    [0x8C] = 4,
+    [0x8D] = 4,
+    [0x8E] = 4,
+    [0x90] = 3,
+    [0x91] = 6,
+    [0x94] = 4,
+    [0x95] = 4,
+    [0x96] = 4,
+    [0x98] = 2,
+    [0x99] = 5,
+    [0x9A] = 2,
+    [0x9D] = 5,
+    [0xA0] = 2,
+    [0xA1] = 6,
+    [0xA2] = 2,
+    [0xA4] = 3,
+    [0xA5] = 3,
+    [0xA6] = 3,
+    [0xA8] = 2,
+    [0xA9] = 2,
+    [0xAA] = 2,
+    [0xAC] = 4,
+    [0xAD] = 4,
+    [0xAE] = 4,
+    [0xB0] = 3,
+    [0xB1] = 5,
+    [0xB4] = 3,
+    [0xB5] = 3,
+    [0xB6] = 3,
+    [0xB8] = 2,
+    [0xB9] = 3,
+    [0xBA] = 2,
+    [0xBC] = 3,
+    [0xBD] = 3,
+    [0xBE] = 3,
+    [0xC0] = 2,
+    [0xC1] = 6,
+    [0xC2] = 2,
+    [0xC4] = 3,
+    [0xC5] = 3,
+    [0xC6] = 5,
+    [0xC8] = 2,
+    [0xC9] = 2,
+    [0xCA] = 2,
+    [0xCC] = 4,
+    [0xCD] = 4,
+    [0xCE] = 6,
+    [0xD0] = 3,
+    [0xD1] = 5,
+    [0xD5] = 3,
+    [0xD6] = 6,
+    [0xD8] = 2,
+    [0xD9] = 3,
+    [0xDD] = 3,
+    [0xDE] = 7,
+    [0xE0] = 2,
+    [0xE1] = 6,
+    [0xE4] = 3,
+    [0xE5] = 3,
+    [0xE6] = 5,
+    [0xE8] = 2,
+    [0xE9] = 2,
+    [0xEA] = 2,
+    [0xEC] = 4,
+    [0xED] = 4,
+    [0xEE] = 6,
+    [0xF0] = 3,
+    [0xF1] = 5,
+    [0xF5] = 3,
+    [0xF6] = 6,
+    [0xF8] = 2,
+    [0xF9] = 3,
+    [0xFD] = 3,
+    [0xFE] = 7,
+};
+
+static const byte cycles_65C02_ops[256] = {
+    [0x04] = 5,
+    [0x0C] = 6,
+    [0x12] = 5,
+    [0x14] = 5,
+    [0x1A] = 2,
+    [0x1C] = 6,
+    [0x32] = 5,
+    [0x34] = 3,
+    [0x3A] = 2,
+    [0x3C] = 3,
+    [0x52] = 5,
+    [0x5A] = 3,
+    [0x64] = 3,
+    [0x6C] = 5,
+    [0x72] = 5,
+    [0x74] = 4,
+    [0x7A] = 4,
+    [0x7C] = 6,
+    [0x80] = 3,
+    [0x89] = 2,
+    [0x92] = 5,
+    [0x9C] = 4,
+    [0x9E] = 5,
+    [0xB2] = 5,
+    [0xD2] = 5,
+    [0xDA] = 3,
+    [0xF2] = 5,
+    [0xFA] = 4,
+};
+
+static byte cycles_65C02[256];
+
+static const byte *cycletable = cycles_6502;
+
+/* The "cached" engine keeps each instruction's opcode and operand
+   byte, along with its handler, so that running it again needn't go
+   through peek() for them. The handlers themselves are unchanged,
+   so every other bus access, and every cycle, happens just as
+   it does in the interpreter. While reads are being traced or
+   counted (--trace-events reads, --stats), it steps aside for the
+   interpreter, so that the fetches are seen as well.
+
+   Only pages whose reads have no side effects (see mem_read_page())
+   are cached, and not instructions at $xxFF, whose operand byte
+   is on the next page. A page's entries are thrown out when
+   it is written to, and all pages' are when the memory map
+   changes. */
+struct decoded {
+    OpHandler   fn;
+    byte        op;
+    byte        immed;
+    bool        valid;
+};
+static struct decoded (*dcache)[0x100]; // [page][offset]
+unsigned long cpu_cache_gen = 1;
+unsigned long cpu_cache_pgen[0x100];  // 0 is never a valid gen
+static bool use_cache = false;
+
+void cpu_init(void)
+{
+    /* Fill in the holes in the 6502 table with the illegal-op handler,
+       and build the 65C02 table from the 6502 one, with the 65C02's
+       additions/replacements laid over it. This way cpu_step() is
+       a single table lookup, with no per-instruction check
+       of which CPU we're emulating. */
+    for (int i = 0; i != 256; ++i) {
+        if (optable_6502[i] == NULL) {
+            optable_6502[i] = op_illegal;
+            cycles_6502[i] = 1; // the rest are counted as they happen
+        }
+        optable_65C02[i] = ops_65C02[i] != NULL?
+            ops_65C02[i] : optable_6502[i];
+        cycles_65C02[i] = ops_65C02[i] != NULL?
+            cycles_65C02_ops[i] : cycles_6502[i];
+    }
+
+    if (machine_is_enhanced_iie()) {
+        optable = optable_65C02;
+        cycletable = cycles_65C02;
+    } else {
+        optable = optable_6502;
+        cycletable = cycles_6502;
+    }
+
+    if (cfg.cpu_engine == NULL || STREQ(cfg.cpu_engine, "interp")) {
+        use_cache = false;
+    } else if (STREQ(cfg.cpu_engine, "cached")) {
+        use_cache = true;
+        dcache = xalloc(0x100 * sizeof dcache[0]);
+    } else {
+        DIE(2, "Unrecognized --cpu-engine \"%s\" (want interp or cached).\n",
+            cfg.cpu_engine);
+    }
+}
+
+static void interp_step(void)
+{
+    /* Cycle references taken from https://www.nesdev.org/6502_cpu.txt. */
+    byte op = pc_get_adv();
+    cycle(); // end 1
+    cycles_base(op);
+
+    byte immed = peek(PC);
+
+    optable[op](op, immed);
+}
+
+static struct decoded *cache_lookup(word pc)
+{
+    byte pg = HI(pc);
+    if (cpu_cache_pgen[pg] != cpu_cache_gen) {
+        if (mem_read_page(pg) == NULL) return NULL;
+        for (int i = 0; i != 0x100; ++i) {
+            dcache[pg][i].valid = false;
+        }
+        cpu_cache_pgen[pg] = cpu_cache_gen;
+    }
+
+    struct decoded *d = &dcache[pg][LO(pc)];
+    if (!d->valid) {
+        if (LO(pc) == 0xFF
+            || event_watched(event_peek_map, pc)
+            || event_watched(event_peek_map, pc + 1)) {
+
+            return NULL;
+        }
+        const byte *mem = mem_read_page(pg);
+        d->op = mem[LO(pc)];
+        d->immed = mem[LO(pc) + 1];
+        d->fn = optable[d->op];
+        d->valid = true;
+    }
+    return d;
+}
+
+static void cached_step(void)
+{
+    if (trace_reads || stats_on) {
+        interp_step();
+        return;
+    }
+    struct decoded *d = cache_lookup(PC);
+    if (d == NULL) {
+        interp_step();
+        return;
+    }
+    PC_ADV;
+    cycle(); // end 1
+    cycles_base(d->op);
+    d->fn(d->op, d->immed);
+}
+
+void cpu_step(void)
+{
+    ProfileMark mark;
+    if (profiling) profile_begin(&mark);
+
+    if (use_cache) {
+        cached_step();
+    } else {
+        interp_step();
     }
 
     ++instr_count;
+    if (profiling) profile_end(&mark);
 }
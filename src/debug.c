@@ -6,22 +6,88 @@
 
 #include "bobbin-internal.h"
 
+#include <ctype.h>
 #include <errno.h>
 #include <stdbool.h>
 #include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+// Conditions on breakpoints ("b 300 if [0] == $41 && X != 0") are
+//  compiled, when they're set, into a short postfix program for a
+//  little stack machine, so that checking one is just a loop over a
+//  handful of instructions.
+enum {
+    C_NUM,      // push val
+    C_REG,      // push register number val
+    C_MEM,      // replace the top with the byte at that address
+    C_NOT,
+    C_NEG,
+    C_CPL,
+    // binary operators, from here on
+    C_ADD,
+    C_SUB,
+    C_AND,
+    C_XOR,
+    C_OR,
+    C_EQ,
+    C_NE,
+    C_LT,
+    C_LE,
+    C_GT,
+    C_GE,
+    C_LAND,
+    C_LOR,
+};
+
+enum { R_A, R_X, R_Y, R_SP, R_P, R_PC };
+static const char *const reg_names[] = {
+    [R_A] = "A", [R_X] = "X", [R_Y] = "Y",
+    [R_SP] = "SP", [R_P] = "P", [R_PC] = "PC",
+};
+
+#define COND_MAX    32      // instructions
+#define COND_STACK  8
+
+typedef struct {
+    byte op;
+    word val;
+} CondInsn;
+
+typedef struct {
+    int         len;
+    CondInsn    code[COND_MAX];
+    char        *text;
+} Cond;
 
 typedef struct Breakpoint Breakpoint;
 struct Breakpoint {
+    int num;
     word loc;
     bool is_watchpoint;
-    byte val;
     bool enabled;
-    Breakpoint *next;
+    Cond *cond;             // NULL if unconditional
+    Breakpoint *next;       // in order of number
+    Breakpoint *next_here;  // next in the same bucket (below)
 };
 
 Breakpoint *bp_head = NULL;
+static Breakpoint **bp_tail = &bp_head;
+static int bp_count = 0;
+
+// Breakpoints and watchpoints, bucketed by the low byte of their
+//  location (as event.c does PC hooks), and a bitmap each of the
+//  locations that have enabled ones. A location with nothing set
+//  costs a single test.
+static Breakpoint *bp_buckets[0x100];
+static uint32_t bp_map[EVENT_MAP_SIZE];
+static uint32_t wp_map[EVENT_MAP_SIZE];
+
+// A watchpoint that's been written to, since the last instruction.
+static Breakpoint *wp_fired = NULL;
+static byte wp_old;
+static byte wp_new;
 
 static char linebuf[256];
 
@@ -32,60 +98,482 @@ static bool cont_dest_flag = false;
 static byte stack_min;
 static word cont_dest;
 
+// Reverse debugging (rs, rc); see below.
+static enum {
+    RW_NONE,
+    RW_GOTO,        // replaying up to rw_target
+    RW_SCAN,        // replaying from rw_from to rw_to, looking
+} rw_mode = RW_NONE;
+static bool rw_stepping;        // rs, rather than rc
+static uintmax_t rw_target;
+static uintmax_t rw_from;
+static uintmax_t rw_to;
+static bool rw_found;
+static uintmax_t rw_hit;        // the last place a breakpoint triggered
+
 bool debugging(void)
 {
     return debugging_flag;
 }
 
+bool debugger_wants_steps(void)
+{
+    // Breakpoints don't need every step: fast_steps() stops at their
+    //  locations, and watchpoints stop it when they fire.
+    return debugging_flag || wp_fired != NULL
+        || go_until_rts || cont_dest_flag
+        || rewind_replaying || rw_mode != RW_NONE;
+}
+
 void dbg_on(void)
 {
     event_fire(EV_UNHOOK);
     debugging_flag = true;
+    step_listeners_changed = true;
     print_message = true;
 }
 
-static void breakpoint_set_(word loc, bool wp)
+/********** Conditions **********/
+
+struct parse {
+    const char  *s;
+    Cond        *c;
+    int         depth;      // of the stack, when the code so far has run
+    const char  *err;
+};
+
+static const struct binop {
+    const char  *tok;
+    int         prec;
+    byte        op;
+} binops[] = {
+    // Two-character operators first, so "<=" isn't taken for "<".
+    { "||", 1, C_LOR },
+    { "&&", 2, C_LAND },
+    { "==", 6, C_EQ },
+    { "!=", 6, C_NE },
+    { "<=", 7, C_LE },
+    { ">=", 7, C_GE },
+    { "|",  3, C_OR },
+    { "^",  4, C_XOR },
+    { "&",  5, C_AND },
+    { "<",  7, C_LT },
+    { ">",  7, C_GT },
+    { "+",  8, C_ADD },
+    { "-",  8, C_SUB },
+};
+
+static void emit(struct parse *p, byte op, word val)
 {
-    Breakpoint *bp = xalloc(sizeof *bp);
+    if (p->err) return;
+    if (p->c->len == COND_MAX) {
+        p->err = "condition too long";
+        return;
+    }
+    p->c->code[p->c->len++] = (CondInsn){ op, val };
+    if (op == C_NUM || op == C_REG) {
+        if (++p->depth > COND_STACK) p->err = "condition nested too deeply";
+    } else if (op >= C_ADD) {
+        --p->depth;
+    }
+}
 
-    bp->loc = loc;
-    bp->enabled = true;
-    bp->next = NULL;
-    bp->is_watchpoint = wp;
-    if (wp) {
-        bp->val = peek_sneaky(loc);
+static void skip_space(struct parse *p)
+{
+    while (*p->s == ' ') ++p->s;
+}
+
+static bool expect(struct parse *p, char c)
+{
+    skip_space(p);
+    if (*p->s != c) {
+        if (!p->err) p->err = c == ')'? "missing )" : "missing ]";
+        return false;
     }
+    ++p->s;
+    return true;
+}
 
-    // Find tail of chain
-    if (bp_head == NULL) {
-        bp_head = bp;
+static void parse_expr(struct parse *p, int min_prec);
+
+// A register name, or a hex number ("$" optional, except to tell $A
+//  from the A register).
+static void parse_word(struct parse *p)
+{
+    bool dollar = *p->s == '$';
+    if (dollar) ++p->s;
+    char buf[8];
+    size_t n = 0;
+    while (isalnum((unsigned char)p->s[n])) ++n;
+    if (n == 0 || n >= sizeof buf) {
+        p->err = n? "number too big" : "expected a number or register";
+        return;
+    }
+    memcpy(buf, p->s, n);
+    buf[n] = '\0';
+    p->s += n;
+    if (!dollar) {
+        for (int r = 0; r != sizeof reg_names / sizeof reg_names[0]; ++r) {
+            if (STREQCASE(buf, reg_names[r])) {
+                emit(p, C_REG, r);
+                return;
+            }
+        }
+        if (STREQCASE(buf, "S")) {
+            emit(p, C_REG, R_SP);
+            return;
+        }
+    }
+    char *end;
+    unsigned long v = strtoul(buf, &end, 16);
+    if (*end != '\0') {
+        p->err = "expected a number or register";
+    } else if (v > 0xFFFF) {
+        p->err = "number too big";
     } else {
-        Breakpoint *tail;
-        for (tail = bp_head; tail->next != NULL; tail = tail->next) {}
-        tail->next = bp;
+        emit(p, C_NUM, v);
     }
+}
+
+static void parse_unary(struct parse *p)
+{
+    skip_space(p);
+    switch (*p->s) {
+        case '!':
+            ++p->s;
+            parse_unary(p);
+            emit(p, C_NOT, 0);
+            break;
+        case '-':
+            ++p->s;
+            parse_unary(p);
+            emit(p, C_NEG, 0);
+            break;
+        case '~':
+            ++p->s;
+            parse_unary(p);
+            emit(p, C_CPL, 0);
+            break;
+        case '(':
+            ++p->s;
+            parse_expr(p, 1);
+            expect(p, ')');
+            break;
+        case '[':
+            ++p->s;
+            parse_expr(p, 1);
+            if (expect(p, ']')) emit(p, C_MEM, 0);
+            break;
+        default:
+            parse_word(p);
+    }
+}
+
+static void parse_expr(struct parse *p, int min_prec)
+{
+    parse_unary(p);
+    while (!p->err) {
+        skip_space(p);
+        const struct binop *b = NULL;
+        for (size_t i = 0; i != sizeof binops / sizeof binops[0]; ++i) {
+            size_t len = strlen(binops[i].tok);
+            if (memcmp(p->s, binops[i].tok, len) == 0) {
+                b = &binops[i];
+                break;
+            }
+        }
+        if (b == NULL || b->prec < min_prec) return;
+        p->s += strlen(b->tok);
+        parse_expr(p, b->prec + 1);
+        emit(p, b->op, 0);
+    }
+}
+
+// Returns NULL (having said why) if TEXT doesn't make sense.
+static Cond *cond_compile(const char *text)
+{
+    Cond *c = xalloc(sizeof *c);
+    c->len = 0;
+    struct parse p = { text, c, 0, NULL };
+    parse_expr(&p, 1);
+    skip_space(&p);
+    if (!p.err && *p.s != '\0') p.err = "garbage at end of condition";
+    if (p.err) {
+        printf("ERR: %s, at \"%s\".\n", p.err, p.s);
+        free(c);
+        return NULL;
+    }
+    c->text = xalloc(strlen(text) + 1);
+    strcpy(c->text, text);
+    return c;
+}
+
+static unsigned int reg_val(word r)
+{
+    switch (r) {
+        case R_A:   return ACC;
+        case R_X:   return XREG;
+        case R_Y:   return YREG;
+        case R_SP:  return SP;
+        case R_P:   return PFLAGS;
+        default:    return PC;
+    }
+}
+
+static long cond_eval(const Cond *c)
+{
+    long st[COND_STACK];
+    int n = 0;
+    for (const CondInsn *in = c->code; in != &c->code[c->len]; ++in) {
+        if (in->op == C_NUM) {
+            st[n++] = in->val;
+            continue;
+        } else if (in->op == C_REG) {
+            st[n++] = reg_val(in->val);
+            continue;
+        }
+        long b = in->op >= C_ADD? st[--n] : 0;
+        long *a = &st[n-1];
+        switch (in->op) {
+            case C_MEM:  *a = peek_sneaky(*a); break;
+            case C_NOT:  *a = !*a; break;
+            case C_NEG:  *a = -*a; break;
+            case C_CPL:  *a = ~*a; break;
+            case C_ADD:  *a += b; break;
+            case C_SUB:  *a -= b; break;
+            case C_AND:  *a &= b; break;
+            case C_XOR:  *a ^= b; break;
+            case C_OR:   *a |= b; break;
+            case C_EQ:   *a = *a == b; break;
+            case C_NE:   *a = *a != b; break;
+            case C_LT:   *a = *a < b; break;
+            case C_LE:   *a = *a <= b; break;
+            case C_GT:   *a = *a > b; break;
+            case C_GE:   *a = *a >= b; break;
+            case C_LAND: *a = *a && b; break;
+            case C_LOR:  *a = *a || b; break;
+        }
+    }
+    return st[0];
+}
+
+/********** Breakpoints **********/
+
+// Just so that fast_steps() stops here; debugger() does the rest.
+static void bp_hook(Event *e)
+{
+}
+
+static void watch_poke(Event *e)
+{
+    if (!event_watched(wp_map, e->loc)) return;
+    if (wp_fired == NULL) {
+        Breakpoint *bp = bp_buckets[LO(e->loc)];
+        while (bp->loc != e->loc || !bp->is_watchpoint || !bp->enabled) {
+            bp = bp->next_here;
+        }
+        wp_fired = bp;
+        wp_old = peek_sneaky(e->loc);
+    }
+    wp_new = e->val;
+    step_listeners_changed = true; // stop before the next instruction
+}
+
+static void set_bit(uint32_t *map, word loc, bool on)
+{
+    if (on) {
+        map[loc / 32] |= (uint32_t)1 << (loc % 32);
+    } else {
+        map[loc / 32] &= ~((uint32_t)1 << (loc % 32));
+    }
+}
+
+// Bring the bitmaps up to date for LOC.
+static void bp_remap(word loc)
+{
+    bool bp = false, wp = false;
+    for (Breakpoint *b = bp_buckets[LO(loc)]; b != NULL; b = b->next_here) {
+        if (b->loc != loc || !b->enabled) continue;
+        if (b->is_watchpoint) {
+            wp = true;
+        } else {
+            bp = true;
+        }
+    }
+    set_bit(bp_map, loc, bp);
+    set_bit(wp_map, loc, wp);
+    if (bp && !event_pc_hooked(EV_PRESTEP, loc)) {
+        event_pc_hook(EV_PRESTEP, loc, bp_hook);
+    }
+    if (wp) {
+        // LOC may already be watched for someone else (the tty
+        //  interface watches the text pages); watch_poke() still needs
+        //  to hear about it.
+        static bool handler_registered = false;
+        if (!handler_registered) {
+            event_reghandler(watch_poke, EVMASK(EV_POKE));
+            handler_registered = true;
+        }
+        if (!event_watched(event_poke_map, loc)) {
+            event_watch(EV_POKE, loc, loc);
+        }
+    }
+}
+
+static void breakpoint_set_(word loc, bool wp, Cond *cond)
+{
+    Breakpoint *bp = xalloc(sizeof *bp);
+
+    bp->num = ++bp_count;
+    bp->loc = loc;
+    bp->enabled = true;
+    bp->is_watchpoint = wp;
+    bp->cond = cond;
+    bp->next = NULL;
+    *bp_tail = bp;
+    bp_tail = &bp->next;
+    bp->next_here = bp_buckets[LO(loc)];
+    bp_buckets[LO(loc)] = bp;
+    bp_remap(loc);
 
     if (wp) {
-        printf("Watchpoint set for $%04X (cur val is $%02X).\n",
-               (unsigned int)bp->loc, (unsigned int)bp->val);
+        printf("Watchpoint %d set for $%04X (cur val is $%02X).\n",
+               bp->num, (unsigned int)loc, (unsigned int)peek_sneaky(loc));
+    } else if (cond) {
+        printf("Breakpoint %d set for $%04X, if %s.\n", bp->num,
+               (unsigned int)loc, cond->text);
     } else {
-        printf("Breakpoint set for $%04X.\n", (unsigned int)bp->loc);
+        printf("Breakpoint %d set for $%04X.\n", bp->num, (unsigned int)loc);
     }
 }
 
 void breakpoint_set(word loc)
 {
-    breakpoint_set_(loc, false);
+    breakpoint_set_(loc, false, NULL);
 }
 
 void watchpoint_set(word loc)
 {
-    breakpoint_set_(loc, true);
+    breakpoint_set_(loc, true, NULL);
+}
+
+// The breakpoint at the PC that's due to trigger, if any.
+static Breakpoint *bp_at_pc(void)
+{
+    word pc = current_pc();
+    if (!event_watched(bp_map, pc)) return NULL;
+    for (Breakpoint *bp = bp_buckets[LO(pc)]; bp != NULL; bp = bp->next_here) {
+        if (bp->loc == pc && !bp->is_watchpoint && bp->enabled
+            && (bp->cond == NULL || cond_eval(bp->cond))) {
+            return bp;
+        }
+    }
+    return NULL;
+}
+
+// Say which watchpoint or breakpoint has triggered, if one has.
+static bool bp_report(void)
+{
+    Breakpoint *bp;
+    if (wp_fired != NULL) {
+        bp = wp_fired;
+        wp_fired = NULL;
+        event_fire(EV_UNHOOK); // Early, so the below message is visible
+        printf("Watchpoint %d fired:\n", bp->num);
+        printf("Write to $%04X ($%02X -> $%02X).\n",
+               (unsigned int)bp->loc, (unsigned int)wp_old,
+               (unsigned int)wp_new);
+        return true;
+    } else if ((bp = bp_at_pc()) != NULL) {
+        event_fire(EV_UNHOOK); // Early, so the below message is visible
+        printf("Breakpoint %d at $%04X.\n", bp->num, current_pc());
+        return true;
+    }
+    return false;
+}
+
+/********** Reverse debugging **********/
+
+// rs and rc (with --rewind) go back to a checkpoint, and replay from
+//  there to the instruction wanted. For rc, that's found by replaying
+//  each stretch of history between checkpoints, latest first, noting
+//  where breakpoints would have triggered, until one has.
+
+// Would a breakpoint or watchpoint have stopped us here?
+static void rw_check(void)
+{
+    if (wp_fired != NULL || bp_at_pc() != NULL) {
+        rw_found = true;
+        rw_hit = instr_count;
+    }
+    wp_fired = NULL;
+}
+
+static void rw_arrived(void)
+{
+    rw_mode = RW_NONE;
+    if (rw_stepping) {
+        wp_fired = NULL;
+    } else if (!bp_report()) {
+        printf("No breakpoints reached, back to the start of history.\n");
+    }
+    printf("At instruction %ju.\n", instr_count);
+}
+
+// Head back for instruction TARGET. True if we're there already.
+static bool rw_goto(uintmax_t target)
+{
+    uintmax_t at;
+    (void) rewind_restore(target, &at);
+    wp_fired = NULL;
+    rw_mode = RW_GOTO;
+    rw_target = target;
+    return at == target;
+}
+
+// Scan the stretch of history before instruction TO. False if there's
+//  none.
+static bool rw_scan_back(uintmax_t to)
+{
+    uintmax_t at;
+    if (to == 0 || !rewind_restore(to - 1, &at)) return false;
+    wp_fired = NULL;
+    rw_mode = RW_SCAN;
+    rw_from = at;
+    rw_to = to;
+    rw_found = false;
+    rw_check();
+    return true;
+}
+
+static bool rw_reached(void)
+{
+    if (rw_mode == RW_GOTO) {
+        if (instr_count < rw_target) {
+            // Only a watchpoint fired by the last instruction counts.
+            wp_fired = NULL;
+            return false;
+        }
+    } else if (instr_count < rw_to) {
+        rw_check();
+        return false;
+    } else if (rw_found) {
+        // The last breakpoint in this stretch is the one we want.
+        if (!rw_goto(rw_hit)) return false;
+    } else if (rw_scan_back(rw_from)) {
+        return false;
+    } else if (!rw_goto(rewind_oldest())) {
+        return false;
+    }
+    rw_arrived();
+    return true;
 }
 
 static bool bp_reached(void)
 {
-    byte op = peek_sneaky(current_pc());
+    if (rewind_replaying) rewind_step();
+    if (rw_mode != RW_NONE) return rw_reached();
+
     if (go_until_rts && SP >= stack_min) {
         go_until_rts = false;
         event_fire(EV_UNHOOK); // Early, so the below message is visible
@@ -100,59 +588,36 @@ static bool bp_reached(void)
         return true;
     }
 
+    return bp_report();
+}
+
+static Breakpoint *bp_find(int num)
+{
     Breakpoint *bp;
-    word pc = current_pc();
-    int i;
-    for (bp = bp_head, i = 1; bp != NULL; ++i, bp = bp->next) {
-        byte val = peek_sneaky(bp->loc);
-        if (!bp->enabled) {
-            // skip this one
-        } else if (bp->is_watchpoint && val != bp->val) {
-            event_fire(EV_UNHOOK); // Early, so the below message is visible
-            printf("Watchpoint %d fired:\n", i);
-            printf("Value changed at $%04X ($%02X -> $%02X).\n",
-                   (unsigned int)(bp->loc), (unsigned int)bp->val,
-                   (unsigned int)val);
-            bp->val = val;
-            return true;
-        } else if (!bp->is_watchpoint && pc == bp->loc) {
-            event_fire(EV_UNHOOK); // Early, so the below message is visible
-            printf("Breakpoint %d at $%04X.\n", i, current_pc());
-            return true;
-        }
+    for (bp = bp_head; bp != NULL && bp->num != num; bp = bp->next) {}
+    if (bp == NULL) {
+        printf("ERR: no such breakpoint #%d.\n", num);
     }
-    return false;
+    return bp;
 }
 
 static inline void bp_disable(int num)
 {
-    Breakpoint *bp;
-    int i;
-    for (bp = bp_head, i = 1; bp != NULL; ++i, bp = bp->next) {
-        if (i == num) {
-            bp->enabled = false;
-            printf("Breakpoint %d disabled.\n", i);
-            return;
-        }
-    }
-    printf("ERR: no such breakpoint #%d.\n", num);
+    Breakpoint *bp = bp_find(num);
+    if (bp == NULL) return;
+    bp->enabled = false;
+    if (bp == wp_fired) wp_fired = NULL;
+    bp_remap(bp->loc);
+    printf("Breakpoint %d disabled.\n", num);
 }
 
 static inline void bp_enable(int num)
 {
-    Breakpoint *bp;
-    int i;
-    for (bp = bp_head, i = 1; bp != NULL; ++i, bp = bp->next) {
-        if (i == num) {
-            bp->enabled = true;
-            if (bp->is_watchpoint) {
-                bp->val = peek_sneaky(bp->loc);
-            }
-            printf("Breakpoint %d enabled.\n", i);
-            return;
-        }
-    }
-    printf("ERR: no such breakpoint #%d.\n", num);
+    Breakpoint *bp = bp_find(num);
+    if (bp == NULL) return;
+    bp->enabled = true;
+    bp_remap(bp->loc);
+    printf("Breakpoint %d enabled.\n", num);
 }
 
 static inline void preface_read(word loc)
@@ -182,6 +647,10 @@ static void mlcmd_list(word first, word last)
     }
 }
 
+static const char DIVERGE_ERR[] =
+    "ERR: can't change the past here: the disk drive was in use.\n"
+    "(Continue on to the present first.)\n";
+
 static void mlcmd_write(word mem, const char *str)
 {
     unsigned long val;
@@ -197,6 +666,10 @@ static void mlcmd_write(word mem, const char *str)
             break; // done processing writes
         }
 
+        if (!rewind_diverge()) {
+            fputs(DIVERGE_ERR, stdout);
+            break;
+        }
         poke_sneaky(mem, val);
         ++mem;
         str = end;
@@ -228,6 +701,10 @@ static bool handle_monitor_like_cmd(bool *loop)
     if (STREQCASE(str, "L")) {
         mlcmd_list(first, second);
     } else if (STREQCASE(str, "G")) {
+        if (!rewind_diverge()) {
+            fputs(DIVERGE_ERR, stdout);
+            return true;
+        }
         PC = first;
         debugging_flag = *loop = false;
     } else if (*str == '\0') {
@@ -257,6 +734,7 @@ void debugger(void)
 
     go_until_rts = false;
     cont_dest_flag = false;
+    rw_mode = RW_NONE;
 
     sigint_received = 0;
 
@@ -313,6 +791,15 @@ void debugger(void)
             loop = false;
         } else if (HAVE("cycles")) {
             printf("cycles: %" PRIuMAX "\n", cycle_count);
+        } else if (HAVE("stats")) {
+            printf("instructions:     %" PRIuMAX "\n", instr_count);
+            printf("frames:           %" PRIuMAX "\n", frame_count);
+            printf("heap allocations: %" PRIuMAX "\n", alloc_count);
+            stats_print(stdout);
+        } else if (HAVE("stats on") || HAVE("stats off")) {
+            stats_enable(linebuf[7] == 'n');
+            printf("Emulator statistics %s.\n",
+                   stats_on? "on" : "off");
         } else if (linebuf[0] == 'c') {
             if (linebuf[1] == '\0') {
                 fputs("Continuing...\n", stdout);
@@ -329,9 +816,19 @@ void debugger(void)
                 printf("Continuing until $%04X...\n", (unsigned int)dest);
             }
         } else if (linebuf[0] == 'b' && linebuf[1] == ' ') {
-            // FIXME: very crude.
-            unsigned long bploc = strtoul(&linebuf[2], NULL, 16);
-            breakpoint_set(bploc);
+            char *end;
+            unsigned long bploc = strtoul(&linebuf[2], &end, 16);
+            while (*end == ' ') ++end;
+            if (end == &linebuf[2]) {
+                fputs("ERR: 'b' needs an address.\n", stdout);
+            } else if (*end == '\0') {
+                breakpoint_set(bploc);
+            } else if (memcmp(end, "if ", 3) == 0) {
+                Cond *cond = cond_compile(end + 3);
+                if (cond) breakpoint_set_(bploc, false, cond);
+            } else {
+                fputs("ERR: Garbage at end of 'b' command.\n", stdout);
+            }
         } else if (HAVE("n")) {
             byte op = peek_sneaky(current_pc());
             if (op == 0x20) {
@@ -373,6 +870,18 @@ void debugger(void)
                 }
                 bp_enable(dest);
             }
+        } else if (HAVE("rs") || HAVE("rc")) {
+            rw_stepping = linebuf[1] == 's';
+            if (!rewind_on) {
+                fputs("ERR: going backwards needs --rewind.\n", stdout);
+            } else if (instr_count <= rewind_oldest()) {
+                fputs("ERR: already at the start of history.\n", stdout);
+            } else if (rw_stepping && rw_goto(instr_count - 1)) {
+                rw_arrived();
+            } else {
+                if (!rw_stepping) (void) rw_scan_back(instr_count);
+                loop = debugging_flag = false;
+            }
         } else if (HAVE("rts")) {
             // Run until stack is two higher than current
             fputs("Continuing until RTS...\n", stdout);
@@ -393,6 +902,7 @@ void debugger(void)
 #undef HAVE
     }
 
-    if (!debugging_flag)
+    // (Not while we're heading backwards: that's still our business.)
+    if (!debugging_flag && rw_mode == RW_NONE)
         event_fire(EV_REHOOK); // Interface can take over again.
 }
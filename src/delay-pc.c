@@ -6,6 +6,8 @@
 
 #include "bobbin-internal.h"
 
+#include <errno.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -316,6 +318,13 @@ static void delay_step(Event *e)
     }
 }
 
+static void set_delay_pc(word loc)
+{
+    tail->delay_pc = loc;
+    // Only need to be woken up at the locations we're waiting for.
+    event_pc_hook(EV_PRESTEP, loc, delay_step);
+}
+
 static void alloc_rec_at_tail(void)
 {
     struct dlypc_record *newrec = xalloc(sizeof *newrec);
@@ -339,13 +348,13 @@ static void ensure_tail_exists(void)
 /********** External-Linkage Functions **********/
 
 void dlypc_init(void) {
-    event_reghandler(delay_step);
+    // Nothing to do: delay_step() gets PC-hooked by set_delay_pc().
 }
 
 void dlypc_delay_until(word loc) {
     // --delay-pc-until always starts a new "moment"/record
     alloc_rec_at_tail();
-    tail->delay_pc = loc;
+    set_delay_pc(loc);
 }
 
 void dlypc_load(const char *fname) {
@@ -365,7 +374,7 @@ void dlypc_load_basic(const char *fname) {
         // Specified first, so add a --delay-until-pc INPUT
         INFO("--load-basic-bin is the first specified action:.\n");
         INFO("Adding --delay-until-pc INPUT before --load-basic-bin.\n");
-        tail->delay_pc = MON_KEYIN;
+        set_delay_pc(MON_KEYIN);
     }
     else {
         INFO("--load-basic-bin was not the first specified action:.\n");
@@ -391,6 +400,62 @@ void dlypc_reboot(void) {
     process_invalids();
 }
 
+bool dlypc_catch_up(void) {
+    // For other handlers hooked at a --delay-until-pc location, which
+    //  may be called before ours is.
+    delay_step(NULL);
+    return cur == NULL;
+}
+
+bool dlypc_final_delay(word *loc) {
+    bool found = false;
+    for (struct dlypc_record *r = head; r != NULL; r = r->next) {
+        if (r->delay_pc != INVALID_LOC) {
+            *loc = r->delay_pc;
+            found = true;
+        }
+    }
+    return found;
+}
+
+// --connect: describe our --load, --load-basic-bin and --jump-to
+//  requests to a --serve server, one per line. (The server has
+//  already reached its own --delay-until-pc, so ours don't apply.)
+void dlypc_write_requests(FILE *f) {
+    for (struct dlypc_record *r = head; r != NULL; r = r->next) {
+        if (r->load_fname == NULL && r->jump_loc == INVALID_LOC)
+            continue;
+
+        // The server's working directory may not be ours.
+        char *path = NULL;
+        if (r->load_fname != NULL
+            && (path = realpath(r->load_fname, NULL)) == NULL) {
+            DIE(1, "Couldn't find --load file \"%s\": %s\n",
+                r->load_fname, strerror(errno));
+        }
+        fprintf(f, "%s %lu %d %s\n", r->basic_fixup? "basic" : "load",
+                r->load_loc, r->jump_loc, path? path : "");
+        free(path);
+    }
+}
+
+// --serve: carry out one line written by dlypc_write_requests().
+void dlypc_run_request(const char *line) {
+    struct dlypc_record rec = initrec;
+    char kind[8];
+    int pathpos = -1;
+    if (sscanf(line, "%7s %lu %d %n", kind, &rec.load_loc, &rec.jump_loc,
+               &pathpos) != 3 || pathpos < 0
+        || !(STREQ(kind, "load") || STREQ(kind, "basic"))) {
+
+        DIE(2, "--serve: bad request line \"%s\".\n", line);
+    }
+    if (line[pathpos] != '\0')
+        rec.load_fname = line + pathpos;
+    rec.basic_fixup = STREQ(kind, "basic");
+    process_record(&rec);
+}
+
 // iterator abstraction for traversing the files to be loaded
 struct dlypc_file_iter {
     struct dlypc_record *r;
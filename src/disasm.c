@@ -568,80 +568,79 @@ static int get_op_type(byte op)
     return t;
 }
 
-static void pracc_abs(FILE *f, word addr)
+// Note the memory at ADDR: two bytes' worth if ZP, else five.
+static void snap_window(DisasmSnap *d, bool zp, word addr)
 {
-    fprintf(f, "%04X: ", addr);
-    for (int i=0; i!=5; ++i) {
-        byte b = peek_sneaky(addr++);
-        fprintf(f, " %02X", b);
+    DisasmWindow *w = &d->acc[d->nacc++];
+    w->zp = zp;
+    w->addr = addr;
+    if (zp) {
+        w->val[0] = peek_sneaky(addr);
+        w->val[1] = peek_sneaky(LO(addr+1));
+    } else {
+        for (int i=0; i!=5; ++i) {
+            w->val[i] = peek_sneaky(addr++);
+        }
     }
 }
 
-static void pracc_zp(FILE *f, byte addr)
-{
-    fprintf(f, "%02X: %02X %02X   ",
-            addr,
-            peek_sneaky(addr),
-            peek_sneaky(LO(addr+1)));
-}
-
-static void print_access(FILE *f, word pc, const Registers *regs,
-                         int type, byte m[2])
+static void snap_access(DisasmSnap *d, const Registers *regs, int type)
 {
+    const byte *m = &d->m[1];
     switch (type) {
         case T_ZP:
-            pracc_abs(f, WORD(m[0], 0));
+            snap_window(d, false, WORD(m[0], 0));
             break;
         case T_ABSOLUTE:
-            pracc_abs(f, WORD(m[0], m[1]));
+            snap_window(d, false, WORD(m[0], m[1]));
             break;
         case T_ZP_X:
-            pracc_abs(f, WORD(LO(m[0] + regs->x), 0));
+            snap_window(d, false, WORD(LO(m[0] + regs->x), 0));
             break;
         case T_ZP_Y:
-            pracc_abs(f, WORD(LO(m[0] + regs->y), 0));
+            snap_window(d, false, WORD(LO(m[0] + regs->y), 0));
             break;
         case T_ABS_X:
-            pracc_abs(f, WORD(m[0], m[1]) + regs->x);
+            snap_window(d, false, WORD(m[0], m[1]) + regs->x);
             break;
         case T_ABS_Y:
-            pracc_abs(f, WORD(m[0], m[1]) + regs->y);
+            snap_window(d, false, WORD(m[0], m[1]) + regs->y);
             break;
 
         case T_INDY:
             {
-                pracc_zp(f, m[0]);
+                snap_window(d, true, m[0]);
                 byte lo = peek_sneaky(m[0]);
                 byte hi = peek_sneaky(m[0]+1);
-                pracc_abs(f, WORD(lo, hi) + regs->y);
+                snap_window(d, false, WORD(lo, hi) + regs->y);
             }
             break;
         case T_INDX:
             {
-                pracc_zp(f, LO(m[0] + regs->x));
+                snap_window(d, true, LO(m[0] + regs->x));
                 byte lo = peek_sneaky(m[0]);
                 byte hi = peek_sneaky(m[0]+1);
-                pracc_abs(f, WORD(lo, hi));
+                snap_window(d, false, WORD(lo, hi));
             }
             break;
         case T_JMP_IND:
-            pracc_abs(f, WORD(m[0], m[1]));
+            snap_window(d, false, WORD(m[0], m[1]));
             break;
         case T_ZP_IND:
             {
-                pracc_zp(f, m[0]);
+                snap_window(d, true, m[0]);
                 byte lo = peek_sneaky(m[0]);
                 byte hi = peek_sneaky(m[0]+1);
-                pracc_abs(f, WORD(lo, hi));
+                snap_window(d, false, WORD(lo, hi));
             }
             break;
         case T_JMP_ABS_X_IND:
             {
                 word w = WORD(m[0], m[1]) + regs->x;
-                pracc_abs(f, w);
+                snap_window(d, false, w);
                 byte lo = peek_sneaky(w);
                 byte hi = peek_sneaky(w+1);
-                pracc_abs(f, WORD(lo, hi));
+                snap_window(d, false, WORD(lo, hi));
             }
             break;
         default:
@@ -649,19 +648,37 @@ static void print_access(FILE *f, word pc, const Registers *regs,
     }
 }
 
-word print_disasm(FILE *f, word pc, const Registers *regs)
+static void print_window(FILE *f, const DisasmWindow *w)
+{
+    if (w->zp) {
+        fprintf(f, "%02X: %02X %02X   ", LO(w->addr), w->val[0], w->val[1]);
+    } else {
+        fprintf(f, "%04X: ", w->addr);
+        for (int i=0; i!=5; ++i) {
+            fprintf(f, " %02X", w->val[i]);
+        }
+    }
+}
+
+void disasm_snap(DisasmSnap *d, word pc, const Registers *regs)
 {
-    byte m[3];
-    for (int i=0; i != (sizeof m); ++i) {
-        m[i] = peek_sneaky(pc+i);
+    d->pc = pc;
+    for (int i=0; i != (sizeof d->m); ++i) {
+        d->m[i] = peek_sneaky(pc+i);
     }
+    d->nacc = 0;
+    snap_access(d, regs, get_op_type(d->m[0]));
+}
 
+word disasm_print_snap(FILE *f, const DisasmSnap *d)
+{
+    const byte *m = d->m;
     const char *mnem = get_op_mnem(m[0]);
     int t = get_op_type(m[0]);
     int n = n_oprnd[t];
 
-    fprintf(f, "%04X:  ", pc);
-    for (int i=0; i != (sizeof m); ++i) {
+    fprintf(f, "%04X:  ", d->pc);
+    for (int i=0; i != (sizeof d->m); ++i) {
         if (i > n) {
             fprintf(f, "   ");
         } else {
@@ -672,7 +689,8 @@ word print_disasm(FILE *f, word pc, const Registers *regs)
     // print mnemonic
     fprintf(f, "    %s ", mnem);
 
-    int cnt = handlers[t](f, pc, &m[1]);
+    byte a[2] = { m[1], m[2] };
+    int cnt = handlers[t](f, d->pc, a);
 
     // pad out the disassembly
     const int pad = 13; // how much space the args should take up,
@@ -684,8 +702,67 @@ word print_disasm(FILE *f, word pc, const Registers *regs)
     }
 
     // put extra information about any memory we're accessing
-    print_access(f, pc, regs, t, &m[1]);
+    for (int i=0; i != d->nacc; ++i) {
+        print_window(f, &d->acc[i]);
+    }
+    fputc('\n', f);
+
+    return d->pc + 1 + n;
+}
+
+word print_disasm(FILE *f, word pc, const Registers *regs)
+{
+    DisasmSnap d;
+    disasm_snap(&d, pc, regs);
+    return disasm_print_snap(f, &d);
+}
+
+void disasm_snap_state(StateSnap *s, word pc, const Registers *reg)
+{
+    s->regs = *reg;
+    s->regs.pc = pc;
+    byte sp = reg->sp - 3;
+    for (int i=0; i != (sizeof s->stack); ++i) {
+        s->stack[i] = peek_sneaky(WORD(sp++,0x1));
+    }
+    disasm_snap(&s->dis, pc, reg);
+}
+
+void disasm_print_state(FILE *f, const StateSnap *s)
+{
+    static const char fnams[] = "CZIDBUVN";
+    const Registers *reg = &s->regs;
+
+    // Print registers
+    fprintf(f, "ACC: %02X  X: %02X  Y: %02X  SP: %02X", // takes 31 chars
+           reg->a, reg->x, reg->y, reg->sp);
+    fprintf(f, "%8c", ' '); // bring it to 39 (first flag starts on #41)
+
+    // Print status flags
+    for (int i=7; i != -1; --i) {
+        fputc(' ', f);
+        char c = fnams[i];
+        if (RPTEST(reg->p,i)) {
+            fprintf(f, " [%c]", c);
+        } else {
+            fprintf(f, "  %c ", c);
+        }
+    }
+    fputc('\n', f);
+
+    // Print stack
+    byte sp = reg->sp - 3;
+    fprintf(f, "STK: $1%02X:", sp);
+    for (int i=0; i != (sizeof s->stack); ++i) {
+        if (!sp) fprintf(f, "  |");
+        if (sp == reg->sp)
+            fprintf(f, "  (%02X)", s->stack[i]);
+        else
+            fprintf(f, "  %02X", s->stack[i]);
+        ++sp;
+    }
     fputc('\n', f);
 
-    return pc + 1 + n;
+    // Print current location and instruction
+    (void) disasm_print_snap(f, &s->dis);
 }
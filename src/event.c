@@ -17,6 +17,16 @@ struct timedfn {
 struct timedfn *tmhead = NULL;
 bool timer_access = false;
 
+// Expired/cancelled timers are kept here for re-use, so that
+//  (e.g.) the disk motor turning on and off doesn't hit the heap.
+static struct timedfn *tmfree = NULL;
+
+static void timer_release(struct timedfn *p)
+{
+    p->next = tmfree;
+    tmfree = p;
+}
+
 void frame_timer_cancel(void (*fn)(void))
 {
     assert(!timer_access);
@@ -26,7 +36,7 @@ void frame_timer_cancel(void (*fn)(void))
     for (p = tmhead; p != NULL; p = p->next) {
         if (p->fn == fn) {
             *prevnext = p->next;
-            free(p);
+            timer_release(p);
             break;
         }
         prevnext = &p->next;
@@ -59,7 +69,12 @@ void frame_timer(unsigned int time, void (*fn)(void))
 
     // Otherwise, create
     if (p == NULL) {
-        struct timedfn *newtm = xalloc(sizeof *newtm);
+        struct timedfn *newtm = tmfree;
+        if (newtm != NULL) {
+            tmfree = newtm->next;
+        } else {
+            newtm = xalloc(sizeof *newtm);
+        }
         newtm->fn = fn;
         newtm->frames_left = time;
         newtm->next = tmhead;
@@ -75,7 +90,7 @@ void frame_timer_countdown(void)
         if (--(p->frames_left) == 0) {
             p->fn();
             *prevnext = p->next;
-            free(p);
+            timer_release(p);
             p = *prevnext;
         } else {
             prevnext = &(p->next);
@@ -89,7 +104,33 @@ struct handler {
     struct handler *next;
 };
 
-static struct handler *head = NULL;
+// One list of handlers for each event type.
+static struct handler *heads[EV_NUM_TYPES];
+
+// One bit per bus address, for which someone has asked to see
+//  EV_PEEK (resp. EV_POKE) events. Memory accesses anywhere else
+//  skip the event machinery entirely.
+uint32_t event_peek_map[EVENT_MAP_SIZE];
+uint32_t event_poke_map[EVENT_MAP_SIZE];
+
+// Handlers that only care about particular PC values, for EV_PRESTEP
+//  or EV_STEP. Hooks are bucketed by the low byte of the PC, and a
+//  bitmap (like the peek/poke ones) lets the common case, where
+//  nothing is hooked at the current PC, bail out in a single test.
+struct pchook {
+    word pc;
+    event_handler fn;
+    bool iface;     // the interface's (so skipped in --rewind replays)
+    struct pchook *next;
+};
+static struct pchook *pchooks[2][0x100];
+static uint32_t pchook_map[2][EVENT_MAP_SIZE];
+uint32_t event_pc_map[EVENT_MAP_SIZE]; // either of the above
+
+static inline int pchook_idx(EventType type)
+{
+    return type == EV_STEP;
+}
 
 static const Event evinit = {
     .suppress = false,
@@ -101,12 +142,65 @@ void events_init(void)
     // No-op for now
 }
 
-void event_reghandler(event_handler fn)
+void event_reghandler(event_handler fn, EventMask types)
+{
+    if (types & (EVMASK(EV_PRESTEP) | EVMASK(EV_STEP))) {
+        step_listeners_changed = true;
+    }
+    for (int t = 0; t != EV_NUM_TYPES; ++t) {
+        if (!(types & EVMASK(t))) continue;
+        struct handler *h = xalloc(sizeof *h);
+        h->fn = fn;
+        h->next = heads[t];
+        heads[t] = h;
+    }
+}
+
+void event_watch(EventType type, word first, word last)
 {
-    struct handler *h = xalloc(sizeof *h);
+    assert(type == EV_PEEK || type == EV_POKE);
+    assert(first <= last);
+    uint32_t *map = type == EV_PEEK? event_peek_map : event_poke_map;
+    for (unsigned long loc = first; loc <= last; ++loc) {
+        map[loc / 32] |= (uint32_t)1 << (loc % 32);
+    }
+    // Cached instructions may have skipped peeks that now need events.
+    cpu_cache_flush();
+}
+
+void event_pc_hook(EventType type, word pc, event_handler fn)
+{
+    assert(type == EV_PRESTEP || type == EV_STEP);
+    int i = pchook_idx(type);
+    struct pchook *h = xalloc(sizeof *h);
+    h->pc = pc;
     h->fn = fn;
-    h->next = head;
-    head = h;
+    h->iface = iface_handling;
+    h->next = pchooks[i][LO(pc)];
+    pchooks[i][LO(pc)] = h;
+    pchook_map[i][pc / 32] |= (uint32_t)1 << (pc % 32);
+    event_pc_map[pc / 32] |= (uint32_t)1 << (pc % 32);
+}
+
+bool event_pc_hooked(EventType type, word pc)
+{
+    return event_watched(pchook_map[pchook_idx(type)], pc);
+}
+
+bool event_has_handlers(EventType type)
+{
+    return heads[type] != NULL;
+}
+
+static void fire_pc_hooks(Event *e)
+{
+    word pc = PC;
+    int i = pchook_idx(e->type);
+    if (!event_watched(pchook_map[i], pc)) return;
+    for (struct pchook *h = pchooks[i][LO(pc)];
+         pc == PC && h != NULL; h = h->next) {
+        if (h->pc == pc && !(h->iface && rewind_replaying)) h->fn(e);
+    }
 }
 
 void event_unreghandler(event_handler h)
@@ -126,17 +220,35 @@ void dispatch(Event *e)
                 DIE(1,"PC changed during prestep %u times!\n", max_count);
             }
             pc = PC;
-            for (h = head; pc == PC && h != NULL; h = h->next) {
+            fire_pc_hooks(e);
+            for (h = heads[EV_PRESTEP]; pc == PC && h != NULL; h = h->next) {
                 h->fn(e);
             }
         } while (pc != PC);
     } else {
-        for (h = head; h != NULL; h = h->next) {
+        if (e->type == EV_STEP) {
+            fire_pc_hooks(e);
+        }
+        for (h = heads[e->type]; h != NULL; h = h->next) {
             h->fn(e);
         }
     }
 }
 
+// --stats bookkeeping, around the handling of an event.
+static inline uintmax_t stats_start(void)
+{
+    return stats_on? stats_clock() : 0;
+}
+
+static inline void stats_done(EventType t, uintmax_t start)
+{
+    if (stats_on && start != 0) {
+        ++counters.events[t];
+        counters.event_ns[t] += stats_clock() - start;
+    }
+}
+
 static bool for_iface_only(EventType t)
 {
     return (t == EV_UNHOOK || t == EV_REHOOK || t == EV_DISPLAY_TOUCH);
@@ -144,9 +256,10 @@ static bool for_iface_only(EventType t)
 
 void event_fire(EventType type)
 {
-    Event *e = xalloc(sizeof *e);
-    *e = evinit;
+    Event ev = evinit;
+    Event *e = &ev;
     e->type = type;
+    uintmax_t start = stats_start();
 
     // special handling
     switch (type) {
@@ -173,11 +286,13 @@ void event_fire(EventType type)
 
     iface_fire(e);
 
-    if (!(e->type == EV_FRAME || e->type == EV_CYCLE // dispatched specially
+    if (!(e->type == EV_CYCLE // dispatched specially
           || for_iface_only(e->type))) {
         dispatch(e);
     }
-    if (e->type == EV_FRAME) {
+    // Timers were armed in the present; a --rewind replay of the past
+    //  mustn't run them down.
+    if (e->type == EV_FRAME && !rewind_replaying) {
         frame_timer_countdown();
     }
 
@@ -185,35 +300,42 @@ void event_fire(EventType type)
         // Not allowed to change PC in STEP, PEEK, POKE events...
         assert(PC == current_pc());
     }
-
-    free(e);
+    stats_done(type, start);
 }
 
 int event_fire_peek(word loc)
 {
-    Event *e = xalloc(sizeof *e);
-    *e = evinit;
+    Event ev = evinit;
+    Event *e = &ev;
     e->type = EV_PEEK;
     e->loc = loc;
+    uintmax_t start = stats_start();
     size_t bufloc; // throw-away
     mem_get_true_access(loc, false, &bufloc, &e->aux, &e->acctype);
     e->aloc = loc | (e->aux? LOC_AUX_START : 0);
     word pc = PC; // may not eq current_instruction, if we're in the midst
                   //  of some CPU thing
-    iface_fire(e);
-    dispatch(e);
+    if (!rewind_replaying) {
+        iface_fire(e);
+        if (record_on || replay_on) record_peek(e);
+        dispatch(e);
+    }
+    if (rewind_on) e->val = rewind_input(e->val);
     assert(pc == PC);
-    int val = e->val;
-    free(e);
-    return val;
+    if (loc == SS_KBD && e->val >= 0) {
+        timing_kbd_read(e->val);
+    }
+    stats_done(EV_PEEK, start);
+    return e->val;
 }
 
 bool event_fire_poke(word loc, byte val)
 {
-    Event *e = xalloc(sizeof *e);
-    *e = evinit;
+    Event ev = evinit;
+    Event *e = &ev;
     e->type = EV_POKE;
     e->loc = loc;
+    uintmax_t start = stats_start();
     size_t bufloc; // throw-away
     mem_get_true_access(loc, true, &bufloc, &e->aux, &e->acctype);
     e->aloc = loc | (e->aux? LOC_AUX_START : 0);
@@ -223,30 +345,31 @@ bool event_fire_poke(word loc, byte val)
     iface_fire(e);
     dispatch(e);
     assert(pc == PC);
-    bool suppress = e->suppress;
-    free(e);
-    return suppress;
+    stats_done(EV_POKE, start);
+    return e->suppress;
 }
 
 void event_fire_disk_active(int val)
 {
-    Event *e = xalloc(sizeof *e);
-    *e = evinit;
+    Event ev = evinit;
+    Event *e = &ev;
     e->type = EV_DISK_ACTIVE;
     e->val = val;
+    uintmax_t start = stats_start();
 
     iface_fire(e);
-    free(e);
+    stats_done(EV_DISK_ACTIVE, start);
 }
 
 void event_fire_switch(SoftSwitchFlagPos f)
 {
-    Event *e = xalloc(sizeof *e);
-    *e = evinit;
+    Event ev = evinit;
+    Event *e = &ev;
     e->type = EV_SWITCH;
     e->val = f;
+    uintmax_t start = stats_start();
 
     iface_fire(e);
     dispatch(e);
-    free(e);
+    stats_done(EV_SWITCH, start);
 }
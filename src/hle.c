@@ -0,0 +1,384 @@
+//  hle.c
+//
+//  Copyright (c) 2025 Micah John Cowan.
+//  This code is licensed under the MIT license.
+//  See the accompanying LICENSE file for details.
+
+//  High-level emulation (--hle) of a few monitor ROM routines.
+//
+//  When execution reaches the entry point of one of the routines
+//  below, we perform its work natively and return to the caller,
+//  instead of stepping through it one instruction at a time.
+//  Each routine is a line-for-line transcription of the ROM code,
+//  so that the registers, flags, memory--and even the return
+//  addresses left behind on the stack--come out exactly as the ROM
+//  would leave them. Only the cycles are different: none are
+//  charged.
+//
+//  This is only done for the Apple ][ and ][+ ROMs, and only when
+//  the ROM matched a known checksum (so never with --rom-file).
+//  The //e monitor's screen routines are different code, and are
+//  left alone.
+//
+//  --hle-check runs each routine both ways, and dies if the
+//  results differ.
+
+#include "bobbin-internal.h"
+
+typedef void (*hle_fn)(void);
+
+/********** Helpers **********/
+
+// These are binary-mode only; hle_hook() refuses to run
+//  with the decimal flag set.
+
+static inline byte nz(byte v)
+{
+    PPUT(PNEG, v & 0x80);
+    PPUT(PZERO, v == 0);
+    return v;
+}
+
+static inline void adc(byte val)
+{
+    word sum = ACC + val + PGET(PCARRY);
+    PPUT(POVERFL, ((ACC ^ sum) & (val ^ sum) & 0x80) != 0);
+    PPUT(PCARRY, sum & 0x100);
+    ACC = nz(LO(sum));
+}
+
+static inline void sbc(byte val)
+{
+    adc(~val);
+}
+
+static inline void cmp(byte a, byte b)
+{
+    PPUT(PCARRY, a >= b);
+    (void) nz(a - b);
+}
+
+static inline void inc(word loc)
+{
+    poke(loc, nz(peek(loc) + 1));
+}
+
+static inline word zpword(byte zp)
+{
+    return WORD(peek(zp), peek(zp+1));
+}
+
+// JSR at AT to FN: push the return address just as the real JSR
+//  would, then pop it off again (FN's RTS).
+static void call(word at, hle_fn fn)
+{
+    word ret = at + 2;
+    stack_push(HI(ret));
+    stack_push(LO(ret));
+    fn();
+    (void) stack_pop();
+    (void) stack_pop();
+}
+
+/********** The routines **********/
+
+static void bascalc(void)
+{
+    stack_push(ACC);                    // PHA
+    PPUT(PCARRY, ACC & 1);              // LSR
+    ACC = nz(ACC >> 1);
+    ACC = nz(ACC & 0x03);               // AND #$03
+    ACC = nz(ACC | 0x04);               // ORA #$04
+    poke(ZP_BASH, ACC);                 // STA BASH
+    ACC = nz(stack_pop());              // PLA
+    ACC = nz(ACC & 0x18);               // AND #$18
+    if (PGET(PCARRY))                   // BCC BSCLC2
+        adc(0x7F);                      // ADC #$7F
+    poke(ZP_BASL, ACC);                 // BSCLC2: STA BASL
+    PPUT(PCARRY, ACC & 0x80);           // ASL
+    ACC = nz(ACC << 1);
+    PPUT(PCARRY, ACC & 0x80);           // ASL
+    ACC = nz(ACC << 1);
+    ACC = nz(ACC | peek(ZP_BASL));      // ORA BASL
+    poke(ZP_BASL, ACC);                 // STA BASL
+}
+
+static void vtabz(void)
+{
+    call(MON_VTABZ, bascalc);           // JSR BASCALC
+    adc(peek(ZP_WNDLFT));               // ADC WNDLFT
+    poke(ZP_BASL, ACC);                 // STA BASL
+}
+
+static void vtab(void)
+{
+    ACC = nz(peek(ZP_CV));              // LDA CV
+    vtabz();
+}
+
+static void cleolz(void)
+{
+    ACC = nz(0xA0);                     // LDA #$A0
+    do {
+        poke(zpword(ZP_BASL) + YREG, ACC);  // CLEOL2: STA (BASL),Y
+        YREG = nz(YREG + 1);            // INY
+        cmp(YREG, peek(ZP_WNDWDTH));    // CPY WNDWDTH
+    } while (!PGET(PCARRY));            // BCC CLEOL2
+}
+
+static void clreol(void)
+{
+    YREG = nz(peek(ZP_CH));             // LDY CH
+    cleolz();
+}
+
+static void cleop1(void)
+{
+    do {
+        stack_push(ACC);                // CLEOP1: PHA
+        call(MON_CLREOP + 5, vtabz);    // JSR VTABZ
+        call(MON_CLREOP + 8, cleolz);   // JSR CLEOLZ
+        YREG = nz(0x00);                // LDY #$00
+        ACC = nz(stack_pop());          // PLA
+        adc(0x00);                      // ADC #$00
+        cmp(ACC, peek(ZP_WNDBTM));      // CMP WNDBTM
+    } while (!PGET(PCARRY));            // BCC CLEOP1
+    vtab();                             // BCS VTAB
+}
+
+static void clreop(void)
+{
+    YREG = nz(peek(ZP_CH));             // LDY CH
+    ACC = nz(peek(ZP_CV));              // LDA CV
+    cleop1();
+}
+
+static void home(void)
+{
+    ACC = nz(peek(ZP_WNDTOP));          // LDA WNDTOP
+    poke(ZP_CV, ACC);                   // STA CV
+    YREG = nz(0x00);                    // LDY #$00
+    poke(ZP_CH, YREG);                  // STY CH
+    cleop1();                           // BEQ CLEOP1
+}
+
+static void scroll(void)
+{
+    ACC = nz(peek(ZP_WNDTOP));          // LDA WNDTOP
+    stack_push(ACC);                    // PHA
+    call(MON_SCROLL + 3, vtabz);        // JSR VTABZ
+    for (;;) {
+        ACC = nz(peek(ZP_BASL));        // SCRL1: LDA BASL
+        poke(ZP_BAS2L, ACC);            // STA BAS2L
+        ACC = nz(peek(ZP_BASH));        // LDA BASH
+        poke(ZP_BAS2H, ACC);            // STA BAS2H
+        YREG = nz(peek(ZP_WNDWDTH));    // LDY WNDWDTH
+        YREG = nz(YREG - 1);            // DEY
+        ACC = nz(stack_pop());          // PLA
+        adc(0x01);                      // ADC #$01
+        cmp(ACC, peek(ZP_WNDBTM));      // CMP WNDBTM
+        if (PGET(PCARRY)) break;        // BCS SCRL3
+        stack_push(ACC);                // PHA
+        call(MON_SCROLL + 0x19, vtabz); // JSR VTABZ
+        do {
+            ACC = nz(peek(zpword(ZP_BASL) + YREG));  // SCRL2: LDA (BASL),Y
+            poke(zpword(ZP_BAS2L) + YREG, ACC);     // STA (BAS2L),Y
+            YREG = nz(YREG - 1);        // DEY
+        } while (!PGET(PNEG));          // BPL SCRL2
+    }                                   // BMI SCRL1
+    YREG = nz(0x00);                    // SCRL3: LDY #$00
+    call(MON_SCROLL + 0x27, cleolz);    // JSR CLEOLZ
+    // BCS VTAB. CLEOLZ always returns with carry set, so this is
+    //  always taken.
+    vtab();
+}
+
+static void nxta4(void)
+{
+    inc(ZP_A4L);                        // INC A4L
+    if (PGET(PZERO))                    // BNE NXTA1
+        inc(ZP_A4H);                    // INC A4H
+    ACC = nz(peek(ZP_A1L));             // NXTA1: LDA A1L
+    cmp(ACC, peek(ZP_A2L));             // CMP A2L
+    ACC = nz(peek(ZP_A1H));             // LDA A1H
+    sbc(peek(ZP_A2H));                  // SBC A2H
+    inc(ZP_A1L);                        // INC A1L
+    if (PGET(PZERO))                    // BNE RTS4B
+        inc(ZP_A1H);                    // INC A1H
+}
+
+static void move(void)
+{
+    do {
+        ACC = nz(peek(zpword(ZP_A1L) + YREG));  // LDA (A1L),Y
+        poke(zpword(ZP_A4L) + YREG, ACC);       // STA (A4L),Y
+        call(MON_MOVE + 4, nxta4);      // JSR NXTA4
+    } while (!PGET(PCARRY));            // BCC MOVE
+}
+
+/********** Guards **********/
+
+// Does [START, START+LEN) overlap [LO, HI)?
+//  (Allowing for the range to wrap past $FFFF.)
+static bool range_touches(word start, unsigned long len,
+                          unsigned long lo, unsigned long hi)
+{
+    unsigned long end = start + len;
+    return (start < hi && end > lo) || end > 0x10000 + lo;
+}
+
+// MOVE runs until A1 passes A2; make sure it won't read or write any
+//  soft switches on the way, since their side effects (and timing)
+//  aren't ours to reproduce. Nor may it write over its own pointers,
+//  which would make the range we just checked meaningless.
+static bool move_ok(void)
+{
+    word a1 = zpword(ZP_A1L);
+    word a2 = zpword(ZP_A2L);
+    word a4 = zpword(ZP_A4L);
+    unsigned long len = a2 >= a1? (unsigned long)(a2 - a1) + 1 : 1;
+    return !range_touches(a1 + YREG, len, SS_START, LOC_ROM_START)
+        && !range_touches(a4 + YREG, len, SS_START, LOC_ROM_START)
+        && !range_touches(a4 + YREG, len, ZP_A1L, ZP_A4H + 1);
+}
+
+/********** Hooks **********/
+
+struct routine {
+    const char *    name;
+    word            loc;
+    hle_fn          fn;
+    bool            (*ok)(void);
+};
+
+static const struct routine routines[] = {
+    { "CLREOP", MON_CLREOP, clreop, NULL },
+    { "HOME",   MON_HOME,   home,   NULL },
+    { "SCROLL", MON_SCROLL, scroll, NULL },
+    { "CLREOL", MON_CLREOL, clreol, NULL },
+    { "CLEOLZ", MON_CLEOLZ, cleolz, NULL },
+    { "MOVE",   MON_MOVE,   move,   move_ok },
+};
+
+// --hle-check state
+static struct {
+    bool                    pending;
+    const struct routine *  r;
+    word                    from;
+    Registers               regs;
+} chk;
+static byte saved_mem[SS_START];
+static byte native_mem[SS_START];
+
+static size_t ram_top(void)
+{
+    return cfg.amt_ram < SS_START? cfg.amt_ram : SS_START;
+}
+
+static void snapshot(byte *buf)
+{
+    for (size_t loc = 0; loc != ram_top(); ++loc)
+        buf[loc] = peek_sneaky(loc);
+}
+
+static void check_fail(const char *what)
+{
+    DIE(0, "--hle-check: %s (called from $%04X) differs from ROM: %s\n",
+        chk.r->name, (unsigned int)chk.from, what);
+    fputs("Native result:\n", stderr);
+    util_print_state(stderr, chk.regs.pc, &chk.regs);
+    fputs("ROM result:\n", stderr);
+    util_print_state(stderr, PC, &theCpu.regs);
+    DIE_FINAL(1);
+}
+
+// Runs at every instruction, in --hle-check mode, to catch the ROM
+//  routine returning to its caller.
+static void check_step(Event *e)
+{
+    if (!chk.pending || PC != chk.regs.pc || SP != chk.regs.sp)
+        return;
+    chk.pending = false;
+
+    if (ACC != chk.regs.a || XREG != chk.regs.x || YREG != chk.regs.y
+        || PFLAGS != chk.regs.p) {
+
+        check_fail("registers");
+    }
+    for (size_t loc = 0; loc != ram_top(); ++loc) {
+        if (peek_sneaky(loc) != native_mem[loc]) {
+            char buf[64];
+            snprintf(buf, sizeof buf, "memory at $%04zX: $%02X vs $%02X",
+                     loc, (unsigned int)native_mem[loc],
+                     (unsigned int)peek_sneaky(loc));
+            check_fail(buf);
+        }
+    }
+}
+
+// Run the routine natively, remember the results, then put
+//  everything back the way it was and let the ROM have its turn.
+static void check_start(const struct routine *r)
+{
+    Registers before = theCpu.regs;
+    snapshot(saved_mem);
+
+    r->fn();
+    rts();
+
+    chk.pending = true;
+    chk.r = r;
+    chk.from = WORD(peek_sneaky(WORD(LO(before.sp+1), 0x1)),
+                    peek_sneaky(WORD(LO(before.sp+2), 0x1))) - 2;
+    chk.regs = theCpu.regs;
+    snapshot(native_mem);
+
+    for (size_t loc = 0; loc != ram_top(); ++loc) {
+        if (native_mem[loc] != saved_mem[loc])
+            poke_sneaky(loc, saved_mem[loc]);
+    }
+    theCpu.regs = before;
+}
+
+static void hle_hook(Event *e)
+{
+    const struct routine *r = routines;
+    while (r->loc != PC) ++r;
+
+    MemAccessType acc;
+    mem_get_true_access(PC, false, NULL, NULL, &acc);
+    if (acc != MA_ROM           // bank-switched RAM may hold anything
+        || PTEST(PDEC)          // our arithmetic is binary-only
+        || debugging() || tracing()
+        || (r->ok && !r->ok()))
+        return;
+
+    if (cfg.hle_check) {
+        if (!chk.pending)
+            check_start(r);
+        return;
+    }
+
+    r->fn();
+    rts();
+}
+
+void hle_init(void)
+{
+    if (!cfg.hle && !cfg.hle_check) return;
+
+    if (machine_is_iie() || !machine_rom_validated()) {
+        WARN("--hle only supports the stock Apple ][ and ][+ ROMs;"
+             " ignored.\n");
+        return;
+    }
+
+    const struct routine *end = routines
+        + (sizeof routines)/(sizeof routines[0]);
+    for (const struct routine *r = routines; r != end; ++r) {
+        event_pc_hook(EV_PRESTEP, r->loc, hle_hook);
+    }
+    if (cfg.hle_check) {
+        event_reghandler(check_step, EVMASK(EV_PRESTEP));
+    }
+}
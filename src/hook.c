@@ -12,6 +12,8 @@ static void trap_step(Event *e)
     if (cfg.trap_failure_on && current_pc() == cfg.trap_failure) {
         fputs("*** ERROR TRAP REACHED ***\n", stderr);
         fprintf(stderr, "Instr #: %ju\n", instr_count);
+        fprintf(stderr, "Cycles: %ju\n",
+                frame_count * CYCLES_PER_FRAME + cycle_count);
         fprintf(stderr, "Failed testcase: %02X\n",
                 peek_sneaky(0x200));
 
@@ -25,6 +27,9 @@ static void trap_step(Event *e)
         exit(3);
     } else if (cfg.trap_success_on && current_pc() == cfg.trap_success) {
         fputs(".-= !!! REPORT SUCCESS !!! =-.\n", stderr);
+        fprintf(stderr, "Instr #: %ju\n", instr_count);
+        fprintf(stderr, "Cycles: %ju\n",
+                frame_count * CYCLES_PER_FRAME + cycle_count);
         exit(0);
     }
 }
@@ -110,10 +115,16 @@ void hooks_init(void)
     memlog = fopen("memlog.log", "w");
     if (memlog == NULL) DIE(1,"Couldn't open memlog.\n");
     memset(savedsw, 0, (sizeof savedsw)/(sizeof savedsw[0]));
-    event_reghandler(log_prodos_switches);
+    event_reghandler(log_prodos_switches, EVMASK(EV_RESET) | EVMASK(EV_SWITCH)
+                                          | EVMASK(EV_PEEK) | EVMASK(EV_POKE));
+    event_watch(EV_PEEK, 0x0000, 0xFFFF);
+    event_watch(EV_POKE, 0x0000, 0xFFFF);
 #endif
 
-    if (cfg.trap_failure_on || cfg.trap_success_on) {
-        event_reghandler(trap_step);
+    if (cfg.trap_failure_on) {
+        event_pc_hook(EV_STEP, cfg.trap_failure, trap_step);
+    }
+    if (cfg.trap_success_on) {
+        event_pc_hook(EV_STEP, cfg.trap_success, trap_step);
     }
 }
@@ -15,6 +15,7 @@ extern IfaceDesc ttyInterface;
 #endif
 
 static IfaceDesc *iii = NULL;
+bool iface_handling = false;
 
 static struct if_t {
     const char *name;
@@ -28,8 +29,20 @@ static struct if_t {
 
 void iface_fire(Event *e)
 {
-    if (iii->event)
+    // The interface sits out --rewind replays: it's seen it all before.
+    //  (But it's still told when to get out of the debugger's way.)
+    bool sit_out = rewind_replaying && e->type != EV_UNHOOK
+        && e->type != EV_REHOOK && e->type != EV_DISPLAY_TOUCH;
+    // Under --replay, the recording stands in for the keyboard.
+    if (replay_on && (e->type == EV_PEEK || e->type == EV_POKE)) {
+        sit_out = true;
+    }
+    if (iii->event && !sit_out) {
+        bool was = iface_handling;
+        iface_handling = true;
         iii->event(e);
+        iface_handling = was;
+    }
 }
 
 static
@@ -58,7 +71,7 @@ void interfaces_init(void)
         if (cfg.remain_after_pipe || cfg.remain_tty) {
             DIE(2,"--tokenize conflicts with --remain.\n");
         }
-    } else if (cfg.detokenize || cfg.runbasicfile) {
+    } else if (cfg.detokenize || cfg.runbasicfile || cfg.replay_file) {
         // Force interface to "simple".
         cfg.interface = "simple";
     } if (cfg.interface == NULL) {
@@ -32,6 +32,9 @@ static enum {
     LIST_DOING_LIST,
 } detoken_state = LIST_AWAITING_NXTCHR;
 static bool exit_on_spindown;
+// Our event_pc_hook()s stay put after --remain-tty hands over to the
+//  tty interface; they check this first.
+static bool active = false;
 static int tokenfd;
 static int inputfd = 0;
 static enum {
@@ -73,6 +76,7 @@ static void transition_tty(void)
     util_reopen_stdin_tty(O_RDONLY);
 
     INFO("--remain-tty, switching to tty interface...\n");
+    active = false;
     cfg.interface = "tty";
     interfaces_init();
     interfaces_start();
@@ -462,10 +466,41 @@ static void iface_simple_init(void)
     handle_run_basic();
 }
 
+static void iface_simple_prestep(Event *e);
+static void strict_basic_step(Event *e);
+static void iface_simple_step(Event *e);
+
 static void iface_simple_start(void)
 {
     line_number = 0;
     curlnsz = 0;
+    active = true;
+
+    // Firmware locations we react to.
+    static const word step_pcs[] = {
+        MON_COUT1, MON_NXTCHR, FP_RESTART, MON_GETLNZ, MON_GETLN,
+        INT_SETPROMPT, MON_GO, FP_LIST, FP_NEWSTT,
+    };
+    for (size_t i = 0; i != (sizeof step_pcs)/(sizeof step_pcs[0]); ++i) {
+        event_pc_hook(EV_STEP, step_pcs[i], iface_simple_step);
+    }
+    if (cfg.tokenize || cfg.runbasicfile) {
+        static const word strict_pcs[] = {
+            FP_ERROR2, FP_NOT_NUMBERED, FP_LINE_EXISTS, FP_CK_PAST_LINE,
+        };
+        for (size_t i = 0;
+             i != (sizeof strict_pcs)/(sizeof strict_pcs[0]); ++i) {
+            event_pc_hook(EV_STEP, strict_pcs[i], strict_basic_step);
+        }
+    }
+    event_pc_hook(EV_PRESTEP, MON_MONZ, iface_simple_prestep);
+    if (cfg.trap_print_on && cfg.trap_print != MON_MONZ) {
+        event_pc_hook(EV_PRESTEP, cfg.trap_print, iface_simple_prestep);
+    }
+
+    // Keyboard and keyboard strobe.
+    event_watch(EV_PEEK, SS_KBD, SS_KBDSTROBE | 0xF);
+    event_watch(EV_POKE, SS_KBDSTROBE, SS_KBDSTROBE | 0xF);
 
     setvbuf(stdout, NULL, _IONBF, 0);
 
@@ -613,8 +648,9 @@ static void prompt_wozbasic(void)
     }
 }
 
-static void iface_simple_prestep(void)
+static void iface_simple_prestep(Event *e)
 {
+    if (!active) return;
     if (current_pc() == MON_MONZ) {
         if (!mon_entered) {
             mon_entered = true;
@@ -633,8 +669,9 @@ static void iface_simple_prestep(void)
     }
 }
 
-static void strict_basic_step(void)
+static void strict_basic_step(Event *e)
 {
+    if (!active) return;
     switch (current_pc()) {
         case FP_ERROR2:
             tokenize_err();
@@ -657,11 +694,9 @@ static void strict_basic_step(void)
     }
 }
 
-static void iface_simple_step(void)
+static void iface_simple_step(Event *e)
 {
-    if (cfg.tokenize || cfg.runbasicfile) {
-        strict_basic_step();
-    }
+    if (!active) return;
     switch (current_pc()) {
         // XXX these should check that firmware is active
         case MON_COUT1:
@@ -765,6 +800,20 @@ static void iface_simple_rehook(void)
     (void) fcntl(0, F_SETFL, flags | O_NONBLOCK);
 }
 
+// Is GETLN waiting on a character? (Its NXTCHR's return address
+//  is on the stack.)
+static bool in_getln(void)
+{
+    const word ret = MON_NXTCHR + 2;
+    for (unsigned int sp = SP + 1; sp < 0xFF; ++sp) {
+        if (peek_sneaky(WORD(sp, 0x01)) == LO(ret)
+            && peek_sneaky(WORD(sp + 1, 0x01)) == HI(ret)) {
+            return true;
+        }
+    }
+    return false;
+}
+
 static void iface_simple_event(Event *e)
 {
     switch (e->type) {
@@ -782,12 +831,6 @@ static void iface_simple_event(Event *e)
         case EV_START:
             iface_simple_start();
             break;
-        case EV_PRESTEP:
-            iface_simple_prestep();
-            break;
-        case EV_STEP:
-            iface_simple_step();
-            break;
         case EV_PEEK:
             iface_simple_peek(e);
             break;
@@ -800,6 +843,23 @@ static void iface_simple_event(Event *e)
         case EV_REHOOK:
             iface_simple_rehook();
             break;
+        case EV_STATE_LOAD:
+            // A state saved while waiting for input has already passed
+            //  the NXTCHR where we'd have started suppressing the echo.
+            if (in_getln()
+                && (!interactive || (runbasic_state == RB_LOAD_BASIC))) {
+                suppress_output();
+            }
+            break;
+        case EV_SERVE_CLIENT:
+            // Start over, as if the client's input were all we'd
+            //  ever been given.
+            lbuf_start = lbuf_end = linebuf;
+            eof_found = false;
+            last_char_read = 0;
+            output_seen = false;
+            curlnsz = 0;
+            break;
         case EV_DISK_ACTIVE:
             if (exit_on_spindown && e->val == 0) {
                 INFO("Disk inactive, exiting.\n");
@@ -53,7 +53,7 @@ static void if_tty_unhook(void);
 static void redraw(bool force, int overlay_offset);
 static void breakout(void);
 static void if_tty_frame(void);
-static void if_tty_step(void);
+static void if_tty_step(Event *e);
 static void if_tty_display_touched(void);
 static bool if_tty_squawk(int level, bool cont, const char *fmt, va_list args);
 
@@ -233,7 +233,12 @@ static byte read_char(void) {
     }
 
     int c = 0;
-    if (!unhooked) c = getch();
+    if (!unhooked) {
+        // While the program sits waiting on a key, timing.c polls the
+        //  terminal for us, between frames.
+        c = timing_input_pending()? getch() : ERR;
+        if (c == ERR) timing_input_drained();
+    }
     if (c != ERR && can_clear_messages) {
         can_clear_messages = false;
         clear_overlay();
@@ -264,9 +269,19 @@ static void if_tty_start(void)
     if (!cfg.turbo_was_set) {
         cfg.turbo = false; // default
     }
+
+    // Keyboard, strobe, and open/closed-apple keys.
+    event_watch(EV_PEEK, SS_KBD, SS_KBDSTROBE | 0xF);
+    event_watch(EV_PEEK, 0xC061, 0xC062);
+    event_watch(EV_POKE, SS_KBDSTROBE, SS_KBDSTROBE | 0xF);
+    // Text pages one and two, for the display.
+    event_watch(EV_POKE, LOC_TEXT1, LOC_TEXT2 + text_size - 1);
+    // BELL1, for beeps.
+    event_pc_hook(EV_STEP, 0xFBDD, if_tty_step);
     if (!isatty(STDIN_FILENO)) {
         util_reopen_stdin_tty(O_RDONLY);
     }
+    timing_idle_fd(STDIN_FILENO);
 
     // Do our own SIGTSTP (Control-Z suspend) handling.
     // Ncurses has it builtin, but always restores its windows
@@ -531,7 +546,7 @@ static void if_tty_frame(void)
     }
 }
 
-static void if_tty_step(void)
+static void if_tty_step(Event *e)
 {
     // XXX more checking s/b done here to make sure we're where we think
     // we are.
@@ -589,9 +604,6 @@ static void if_tty_event(Event *e)
                 sigint_received = 0;
             }
             break;
-        case EV_STEP:
-            if_tty_step();
-            break;
         case EV_POKE:
             if_tty_poke(e);
             break;
@@ -617,17 +629,6 @@ static void if_tty_event(Event *e)
             break;
         case EV_DISK_ACTIVE:
             if_tty_disk_active(e->val);
-
-            // If --turbo or --no-turbo weren't explicitly set,
-            //  set turbo on during disk stuff.
-            // XXX should be an option, probably
-            if (cfg.turbo_was_set) {
-                // nevermind
-            } else if (e->val == 0) {
-                cfg.turbo = false;
-            } else {
-                cfg.turbo = true;
-            }
             break;
         default:
             ; // Nothing
@@ -125,6 +125,8 @@ void print_sum(const byte *sum, FILE *fp, int level)
     }
 }
 
+static bool rom_validated = false;
+
 #define MEMEQ(a, b, c)  (!memcmp(a,b,c))
 bool validate_rom(unsigned char *buf, size_t sz)
 {
@@ -143,6 +145,7 @@ bool validate_rom(unsigned char *buf, size_t sz)
                 INFO_CONT("\n");
             }
 
+            rom_validated = true;
             return true;
         }
     }
@@ -218,6 +221,9 @@ void machine_init(void)
         default_romfname = "apple2plus.rom";
         expected_size = 12 * 1024;
     }
+
+    // Now that we know which CPU we have, select its opcode table.
+    cpu_init();
 }
 
 size_t expected_rom_size(void)
@@ -239,3 +245,8 @@ bool machine_has_mousetext(void)
 {
     return is_enhanced_iie;
 }
+
+bool machine_rom_validated(void)
+{
+    return rom_validated;
+}
@@ -21,13 +21,28 @@
 // Enough of a RAM buffer to provide 128k
 //  Note: memory at 0xC000 thru 0xCFFF, and 0x1C000 thru 0x1CFFF,
 //  are read at alternate banks of RAM for locations $D000 - $DFFF
-static byte membuf[128 * 1024];
+//  Normally this is membuf_static; --load-state points it at a
+//  private mapping of the state file instead.
+static byte membuf_static[MEM_RAM_SIZE];
+static byte *membuf = membuf_static;
 
 SoftSwitches ss;
 
 // Pointer to firmware, mapped into the Apple starting at $D000
 static unsigned char *rombuf;
 
+// Page maps: for each of the 256 pages of the address space, a pointer
+//  to where reads (resp. writes) of that page currently land, given
+//  the current soft switch settings. NULL means the page needs the
+//  full treatment (I/O and slot space, ROM writes, missing RAM).
+//  Rebuilt (lazily) whenever a soft switch changes.
+static byte *read_map[0x100];
+static byte *write_map[0x100];
+// Kind of memory each page reads/writes, for --stats.
+static MemAccessType read_acc[0x100];
+static MemAccessType write_acc[0x100];
+static bool map_stale = true;
+
 static const char * const switch_names[] = {
     "LC_PREWRITE",
     "LC_NO_WRITE",
@@ -68,14 +83,37 @@ const byte *getram(void)
     return membuf;
 }
 
+void mem_use_ram(byte *buf)
+{
+    membuf = buf? buf : membuf_static;
+    map_stale = true;
+    cpu_cache_flush();
+    event_fire(EV_DISPLAY_TOUCH);
+}
+
+void mem_map_invalidate(void)
+{
+    map_stale = true;
+}
+
+void mem_restore(const byte *ram, const SoftSwitches sw)
+{
+    memcpy(membuf, ram, MEM_RAM_SIZE);
+    memcpy(ss, sw, sizeof ss);
+    map_stale = true;
+    cpu_cache_flush();
+    event_fire(EV_DISPLAY_TOUCH);
+}
+
 void mem_put(const byte *buf, unsigned long start, size_t sz) {
-    if (start + sz > (sizeof membuf)) {
+    if (start + sz > MEM_RAM_SIZE) {
         size_t oldsz = sz;
-        sz = (sizeof membuf) - start;
+        sz = MEM_RAM_SIZE - start;
         DEBUG("mem_put: truncated PUT sz from %zu to %zu.\n",
               oldsz, sz);
     }
     memcpy(&membuf[start], buf, sz);
+    cpu_cache_flush();
     // Trigger screen refresh. We could be smart and only
     // send this if we know we actually touched the screen, but... meh.
     event_fire(EV_DISPLAY_TOUCH);
@@ -106,6 +144,9 @@ static void swsetfire(SoftSwitches ss, SoftSwitchFlagPos pos, bool val)
     bool oldval = swget(ss, pos);
     swset(ss, pos, val);
     if (oldval != val) {
+        if (stats_on) ++counters.switches[pos];
+        map_stale = true;
+        cpu_cache_flush();
         event_fire_switch(pos);
     }
 }
@@ -239,7 +280,7 @@ static void load_machine_rom(void)
 static void fillmem(void)
 {
     /* Immitate the on-boot memory pattern. */
-    for (size_t z=0; z != sizeof membuf; ++z) {
+    for (size_t z=0; z != MEM_RAM_SIZE; ++z) {
         if (!(z & 0x2))
             membuf[z] = 0xFF;
     }
@@ -251,7 +292,7 @@ static void fillmem(void)
 
     /* For now at least, do what AppleWin does, and
      * set specific bytes to garbage. */
-    for (size_t z=0; z < sizeof membuf; z += 0x200) {
+    for (size_t z=0; z < MEM_RAM_SIZE; z += 0x200) {
         membuf[z + 0x28] = random();
         membuf[z + 0x29] = random();
         membuf[z + 0x68] = random();
@@ -262,16 +303,21 @@ static void fillmem(void)
 static inline void mem_init_langcard(void)
 {
     ss[0] = 0;
+    map_stale = true;
+    cpu_cache_flush();
 }
 
-void mem_init(void)
+void mem_load_rom(void)
 {
-    fillmem();
-
-    if (cfg.load_rom) {
+    if (cfg.load_rom && !rombuf) {
         load_machine_rom();
     }
+}
 
+void mem_init(void)
+{
+    fillmem();
+    mem_load_rom();
     mem_init_langcard();
 }
 
@@ -281,6 +327,8 @@ void mem_reset(void)
     memset(ss, 0, (sizeof ss)/(sizeof ss[0]));
     ss[0] = preserve;
     swset(ss, ss_text, true);
+    map_stale = true;
+    cpu_cache_flush();
 }
 
 void mem_reboot(void)
@@ -366,6 +414,42 @@ void mem_get_true_access(word loc, bool wr, size_t *bufloc, bool *in_aux, MemAcc
     }
 }
 
+static void mem_map_rebuild(void)
+{
+    for (unsigned int pg = 0; pg != 0x100; ++pg) {
+        word loc = pg << 8;
+        size_t bufloc;
+        bool aux;
+        MemAccessType acc;
+
+        read_map[pg] = write_map[pg] = NULL;
+        if (stats_on) {
+            // (stats_enable() sees to it we're rebuilt when it's
+            //  turned on.)
+            mem_get_true_access(loc, false, &bufloc, &aux, &read_acc[pg]);
+            mem_get_true_access(loc, true, &bufloc, &aux, &write_acc[pg]);
+        }
+        if (loc >= SS_START && loc < LOC_SLOTS_END) {
+            continue; // soft switches and slots: always the slow path.
+        }
+
+        if (loc < SS_START && loc >= cfg.amt_ram) {
+            // Missing RAM reads as zero; leave that to peek_sneaky.
+        } else {
+            mem_get_true_access(loc, false, &bufloc, &aux, &acc);
+            read_map[pg] = acc == MA_ROM? &rombuf[bufloc] : &membuf[bufloc];
+        }
+
+        mem_get_true_access(loc, true, &bufloc, &aux, &acc);
+        if (acc != MA_ROM && acc != MA_SLOTS
+            && (!aux || cfg.amt_ram > LOC_AUX_START)) {
+
+            write_map[pg] = &membuf[bufloc];
+        }
+    }
+    map_stale = false;
+}
+
 static int maybe_language_card(word loc, bool wr)
 {
     if ((loc & 0xFFF0) != SS_LANG_CARD) return -1;
@@ -556,16 +640,29 @@ static int switch_reads(word loc)
     return (!!b) << 7;
 }
 
+// --stats: tally an access by the kind of memory it reaches.
+static void count_access(word loc, bool wr)
+{
+    if (map_stale) mem_map_rebuild();
+    if (wr) {
+        ++counters.pokes[write_acc[HI(loc)]];
+    } else {
+        ++counters.peeks[read_acc[HI(loc)]];
+    }
+}
+
 byte peek(word loc)
 {
-    int t = event_fire_peek(loc);
+    int t = -1;
+    if (stats_on) count_access(loc, false);
+    if (event_watched(event_peek_map, loc)) t = event_fire_peek(loc);
     if (t < 0) maybe_language_card(loc, false);
     if (t < 0) t = slot_access_switches(loc, -1);
     if (t < 0) {
         t = peek_sneaky(loc);
     }
 
-    //trace_read(loc, t);
+    if (trace_reads) trace_read(loc, t);
     return (byte) t;
 }
 
@@ -576,7 +673,12 @@ byte peek_sneaky(word loc)
         return (byte) t;
     }
 
-    byte *mem;
+    if (map_stale) mem_map_rebuild();
+    byte *mem = read_map[HI(loc)];
+    if (mem != NULL) {
+        return mem[LO(loc)];
+    }
+
     int val;
     if ((mem = slot_area_access_sneaky(loc, false)) != NULL) {
         return *mem;
@@ -606,7 +708,8 @@ byte peek_sneaky(word loc)
 
 void poke(word loc, byte val)
 {
-    if (event_fire_poke(loc, val))
+    if (stats_on) count_access(loc, true);
+    if (event_watched(event_poke_map, loc) && event_fire_poke(loc, val))
         return;
     trace_write(loc, val);
     if (maybe_language_card(loc, true) >= 0)
@@ -618,10 +721,75 @@ void poke(word loc, byte val)
     poke_sneaky(loc, val);
 }
 
+const byte *mem_read_page(byte pg)
+{
+    if (map_stale) mem_map_rebuild();
+    return read_map[pg];
+}
+
+// Is anything watching any of the N bytes at LOC?
+static bool range_watched(const uint32_t *map, word loc, size_t n)
+{
+    for (size_t i = 0; i != n; ++i) {
+        if (event_watched(map, loc + i)) return true;
+    }
+    return false;
+}
+
+void mem_dma_read(word loc, byte *buf, size_t sz)
+{
+    if (map_stale) mem_map_rebuild();
+    while (sz != 0) {
+        // Up to the end of this page.
+        size_t n = 0x100 - LO(loc);
+        if (n > sz) n = sz;
+        const byte *mem = read_map[HI(loc)];
+        if (mem != NULL && !trace_reads
+            && !range_watched(event_peek_map, loc, n)) {
+            if (stats_on) counters.peeks[read_acc[HI(loc)]] += n;
+            memcpy(buf, &mem[LO(loc)], n);
+        } else {
+            for (size_t i = 0; i != n; ++i) buf[i] = peek(loc + i);
+        }
+        loc += n;
+        buf += n;
+        sz -= n;
+    }
+}
+
+void mem_dma_write(word loc, const byte *buf, size_t sz)
+{
+    if (map_stale) mem_map_rebuild();
+    while (sz != 0) {
+        size_t n = 0x100 - LO(loc);
+        if (n > sz) n = sz;
+        byte *mem = write_map[HI(loc)];
+        if (mem != NULL && !tracing()
+            && !range_watched(event_poke_map, loc, n)) {
+            if (stats_on) counters.pokes[write_acc[HI(loc)]] += n;
+            cpu_cache_dirty(loc);
+            memcpy(&mem[LO(loc)], buf, n);
+        } else {
+            for (size_t i = 0; i != n; ++i) poke(loc + i, buf[i]);
+        }
+        loc += n;
+        buf += n;
+        sz -= n;
+    }
+}
+
 void poke_sneaky(word loc, byte val)
 {
     // XXX should handle slot-area writes
 
+    cpu_cache_dirty(loc);
+    if (map_stale) mem_map_rebuild();
+    byte *mem = write_map[HI(loc)];
+    if (mem != NULL) {
+        mem[LO(loc)] = val;
+        return;
+    }
+
     size_t bufloc;
     bool aux;
     MemAccessType acc;
@@ -25,11 +25,30 @@ PeriphDesc *get_rom_slot(word loc)
     return slot[(loc & 0x0700) >> 8];
 }
 
+// Call P's handler for slot SLOTNUM, counting it for --stats.
+static byte call_handler(PeriphDesc *p, int slotnum,
+                         word loc, int val, int ploc, int psw)
+{
+    if (!stats_on) {
+        return p->handler(loc, val, ploc, psw);
+    }
+    uintmax_t start = stats_clock();
+    byte ret = p->handler(loc, val, ploc, psw);
+    ++counters.periph_calls[slotnum];
+    counters.periph_ns[slotnum] += stats_clock() - start;
+    return ret;
+}
+
 byte periph_sw_peek(word loc)
 {
     PeriphDesc *p = get_sw_slot(loc);
-    if (p) {
-        return p->handler(loc, -1, -1, loc & 0x000F);
+    if (p && rewind_replaying) {
+        rewind_card_skipped();
+        return rewind_input(0); // the card's already been through this
+    } else if (p) {
+        byte val = call_handler(p, (loc & 0x0070) >> 4,
+                                loc, -1, -1, loc & 0x000F);
+        return rewind_on? rewind_input(val) : val;
     } else {
         return 0; // s/b floating bus
     }
@@ -38,8 +57,11 @@ byte periph_sw_peek(word loc)
 void periph_sw_poke(word loc, byte val)
 {
     PeriphDesc *p = get_sw_slot(loc);
-    if (p) {
-        (void) p->handler(loc, val, -1, loc & 0x000F);
+    if (p && rewind_replaying) {
+        rewind_card_skipped();
+    } else if (p) {
+        (void) call_handler(p, (loc & 0x0070) >> 4,
+                            loc, val, -1, loc & 0x000F);
     }
 }
 
@@ -47,7 +69,8 @@ byte periph_rom_peek(word loc)
 {
     PeriphDesc *p = get_rom_slot(loc);
     if (p) {
-        return p->handler(loc, -1, loc & 0x00FF, -1);
+        return call_handler(p, (loc & 0x0700) >> 8,
+                            loc, -1, loc & 0x00FF, -1);
     } else {
         return 0; // s/b floating bus
     }
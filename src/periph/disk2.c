@@ -28,6 +28,7 @@
 
 static bool initialized;
 static bool motor_on;
+static bool motor_stopping; // switched off, but still spinning down
 static bool drive_two;
 static bool write_mode;
 static DiskFormatDesc disk1;
@@ -92,6 +93,36 @@ int eject_disk(int drive)
     return 0;
 }
 
+void disk2_get_state(Disk2State *st)
+{
+    if (!initialized) {
+        // No controller; nothing to save.
+        memset(st, 0, sizeof *st);
+        return;
+    }
+    st->drive_two = drive_two;
+    st->write_mode = write_mode;
+    st->data_register = data_register;
+    memcpy(st->steppers, steppers, sizeof steppers);
+    st->cog[0] = cog1;
+    st->cog[1] = cog2;
+    st->halftrack[0] = disk1.halftrack;
+    st->halftrack[1] = disk2.halftrack;
+}
+
+void disk2_set_state(const Disk2State *st)
+{
+    if (!initialized) return;
+    drive_two = st->drive_two;
+    write_mode = st->write_mode;
+    data_register = st->data_register;
+    memcpy(steppers, st->steppers, sizeof steppers);
+    cog1 = st->cog[0] % 4;
+    cog2 = st->cog[1] % 4;
+    disk1.halftrack = st->halftrack[0] < 70? st->halftrack[0] : 0;
+    disk2.halftrack = st->halftrack[1] < 70? st->halftrack[1] : 0;
+}
+
 PeriphDesc disk2card;
 int insert_disk(int drive, const char *path)
 {
@@ -144,10 +175,12 @@ static void adjust_track(void)
         *cog = ((*cog) + 3) % 4;
         if (disk->halftrack > 0) --disk->halftrack;
         D2DBG("dec to %d", disk->halftrack);
+        trace_disk(TD_HALFTRACK, drive_two? 2 : 1, disk->halftrack);
     } else if (cogright(cog)) {
         *cog = ((*cog) + 1) % 4;
         if (disk->halftrack < 69) ++disk->halftrack;
         D2DBG("inc to %d", disk->halftrack);
+        trace_disk(TD_HALFTRACK, drive_two? 2 : 1, disk->halftrack);
     } else {
         D2DBG("no change (%d)", disk->halftrack);
     }
@@ -171,11 +204,22 @@ static inline byte encode4x4(byte orig)
 static void turn_off_motor(void)
 {
     motor_on = false;
+    motor_stopping = false;
     DiskFormatDesc *disk = active_disk_obj();
     disk->spin(disk, false);
+    trace_disk(TD_MOTOR_OFF, drive_two? 2 : 1, 0);
     event_fire_disk_active(0);
 }
 
+bool disk2_spin_down(void)
+{
+    if (motor_on && motor_stopping) {
+        frame_timer_cancel(turn_off_motor);
+        turn_off_motor();
+    }
+    return !motor_on;
+}
+
 static int lastsw = -1;
 static int lastpc = -1;
 static byte handler(word loc, int val, int ploc, int psw)
@@ -212,18 +256,24 @@ static byte handler(word loc, int val, int ploc, int psw)
         case 0x08:
             if (motor_on) {
                 frame_timer(60, turn_off_motor);
+                motor_stopping = true;
+                timing_io_signal(ACCEL_MOTOR_OFF);
             }
             break;
         case 0x09:
         {
             frame_timer_cancel(turn_off_motor);
             motor_on = true;
+            motor_stopping = false;
             DiskFormatDesc *disk = active_disk_obj();
             disk->spin(disk, true);
+            trace_disk(TD_MOTOR_ON, drive_two? 2 : 1, 0);
+            timing_io_signal(ACCEL_MOTOR_ON);
             event_fire_disk_active(drive_two? 2 : 1);
         }
             break;
         case 0x0A:
+            if (drive_two) trace_disk(TD_SELECT, 1, 0);
             if (motor_on && drive_two) {
                 disk2.spin(&disk2, false);
                 disk1.spin(&disk1, true);
@@ -234,6 +284,7 @@ static byte handler(word loc, int val, int ploc, int psw)
             }
             break;
         case 0x0B:
+            if (!drive_two) trace_disk(TD_SELECT, 2, 0);
             if (motor_on && !drive_two) {
                 disk1.spin(&disk1, false);
                 disk2.spin(&disk2, true);
@@ -251,12 +302,16 @@ static byte handler(word loc, int val, int ploc, int psw)
             } else if (write_mode) {
                 // XXX ignores timing
                 disk->write_byte(disk, data_register);
+                trace_disk(TD_WRITE, drive_two? 2 : 1, data_register);
+                if (stats_on) ++counters.disk_bytes_written;
                 data_register = 0; // "shifted out".
             } else {
                 // XXX any even-numbered switch can be used
                 //  to read a byte. But for now we do so only
                 //  through the sanctioned switch for that purpose.
                 ret = data_register = disk->read_byte(disk);
+                trace_disk(TD_READ, drive_two? 2 : 1, data_register);
+                if (stats_on) ++counters.disk_bytes_read;
             }
         }
             break;
@@ -7,10 +7,13 @@
 #include "bobbin-internal.h"
 
 #include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
 
-#include <sys/stat.h>
+#include <sys/mman.h>
 
 #define SP_DO_READ  0
 #define SP_DO_WRITE 1
@@ -24,6 +27,14 @@
 #define BadBlock 0x2D
 #define BadBuf 0x56
 
+// --hdd-sync idle: blocks written are handed to the host to save once
+//  this many frames go by without another, or SYNC_MAX_FRAMES after
+//  the first of them (plus SYNC_FRAMES), if writes keep coming. The
+//  host saves them in the background (msync() with MS_ASYNC); the only
+//  time the machine waits on them is at exit.
+#define SYNC_FRAMES     60
+#define SYNC_MAX_FRAMES 240
+
 #define RETURN_ERROR(err)    do { \
         ACC = err; \
         PPUT(PCARRY, true); \
@@ -31,11 +42,23 @@
 
 struct SPDev {
     const char *fname;
-    FILE       *fh;
-    off_t       sz;
+    byte       *buf;        // the image, mapped
+    size_t      sz;
     byte        bsz[3];
+    size_t      dirty_lo;   // range written since last handed to the host
+    size_t      dirty_hi;
+    size_t      unsynced_lo; // range written since last saved for certain
+    size_t      unsynced_hi;
 };
 
+static enum {
+    SYNC_ALWAYS,
+    SYNC_IDLE,
+    SYNC_EXIT,
+} sync_policy;
+static uintmax_t dirty_since;   // frame_count at the first block written
+static long pagesz;
+
 const static unsigned int MAX_NDEV = 4;
 unsigned int ndev = 0;
 static struct SPDev devices[4];
@@ -128,6 +151,7 @@ static void handle_status_dib(byte unit, word stlist)
     DEBUG("SP status DIB, unit=%d\n", (int)unit);
     if (unit == 0 || unit > ndev) {
         RETURN_ERROR(DevDiscon);
+        return;
     }
 
     struct SPDev *d = &devices[unit-1];
@@ -164,6 +188,7 @@ static void handle_status(word params)
     
     if (pcount != 3) {
         RETURN_ERROR(BadPCnt);
+        return;
     }
 
     switch (code) {
@@ -179,51 +204,138 @@ static void handle_status(word params)
     }
 }
 
+static uintmax_t sync_clock(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uintmax_t)ts.tv_sec * ONE_SEC_IN_NS + ts.tv_nsec;
+}
+
+// Add [POS, POS + 512) to the range [*LO, *HI).
+static void extend(size_t *lo, size_t *hi, size_t pos)
+{
+    if (*lo == *hi) {
+        *lo = pos;
+        *hi = pos + 512;
+    } else {
+        if (pos < *lo) *lo = pos;
+        if (pos + 512 > *hi) *hi = pos + 512;
+    }
+}
+
+static void sync_range(struct SPDev *d, size_t lo, size_t hi, int flags)
+{
+    uintmax_t start = stats_on? sync_clock() : 0;
+    lo -= lo % pagesz;
+    errno = 0;
+    if (msync(d->buf + lo, hi - lo, flags) < 0) {
+        DIE(1, "Couldn't sync hdd file \"%s\": %s\n", d->fname,
+            strerror(errno));
+    }
+    if (stats_on) {
+        uintmax_t took = sync_clock() - start;
+        ++counters.hdd_syncs;
+        counters.hdd_sync_ns += took;
+        if (took > counters.hdd_sync_max_ns) counters.hdd_sync_max_ns = took;
+    }
+}
+
+// Hand what's been written to the host, to save in the background.
+static void flush_images(void)
+{
+    for (struct SPDev *d = devices; d != devices + ndev; ++d) {
+        if (d->dirty_lo == d->dirty_hi) continue;
+        sync_range(d, d->dirty_lo, d->dirty_hi, MS_ASYNC);
+        d->dirty_lo = d->dirty_hi = 0;
+    }
+}
+
+// Save everything written, and wait till it is.
+static void sync_images(void)
+{
+    for (struct SPDev *d = devices; d != devices + ndev; ++d) {
+        if (d->unsynced_lo == d->unsynced_hi) continue;
+        sync_range(d, d->unsynced_lo, d->unsynced_hi, MS_SYNC);
+        d->dirty_lo = d->dirty_hi = 0;
+        d->unsynced_lo = d->unsynced_hi = 0;
+    }
+}
+
+// Is the block at SEKPOS in host memory already, or will touching it
+//  mean a trip to the host disk?
+static void count_cached(struct SPDev *d, size_t sekpos)
+{
+    size_t lo = sekpos - sekpos % pagesz;
+    unsigned char vec;
+    if (mincore(d->buf + lo, sekpos + 512 - lo, &vec) < 0) return;
+    if (vec & 1) {
+        ++counters.hdd_cache_hits;
+    } else {
+        ++counters.hdd_cache_misses;
+    }
+}
+
+static bool block_ok(struct SPDev *d, off_t blkpos)
+{
+    if (blkpos < 0 || (size_t)blkpos >= d->sz / 512) {
+        WARN("Bad smartport block requested for \"%s\": %jd\n",
+             d->fname, (intmax_t)blkpos);
+        RETURN_ERROR(BadBlock);
+        return false;
+    }
+    return true;
+}
+
 static void write_block(byte unit, off_t blkpos, word buffer)
 {
     if (unit == 0 || unit > ndev) {
         WARN("Bad write_black unit number %d\n", (int)unit);
         RETURN_ERROR(DevDiscon);
+        return;
     }
 
     if (buffer > 0x10000 - 512) {
         WARN("Bad buffer $%04lX provided to write_block\n",
              (unsigned long)buffer);
         RETURN_ERROR(BadBuf);
+        return;
     }
 
     struct SPDev *d = &devices[unit-1];
-    off_t sekpos = blkpos * 512;
+    if (!block_ok(d, blkpos)) return;
+    size_t sekpos = blkpos * 512;
     size_t newloc;
     mem_get_true_access(buffer, false /* reading */,
                         &newloc, NULL, NULL);
     DEBUG("write_block, unit=%d, blk=%zu, buf=%04lX, REALbuf=%04zX\n", (int)unit,
           (size_t)blkpos, (unsigned long)buffer, newloc);
-    errno = 0;
-    DEBUG("fseeko(\"%s\", %zu, SEEK_SET)\n", d->fname, (size_t)sekpos);
-    if (fseeko(d->fh, sekpos, SEEK_SET) < 0) {
-        int err = errno;
-        WARN("Bad smartport block requested for \"%s\", offset %zu: %s\n",
-             d->fname, (size_t)sekpos, strerror(err));
-        RETURN_ERROR(BadBlock);
-    }
-
-    byte buf[512];
-    //const byte *buf = getram();
-
-    // We do an inefficient loop bc it's an easy way
-    // to ensure everything comes from where it actually ought to, in the case
-    // of crossing mapping boundaries (up to 3 different regions of
-    // memory are possible)
-    for (word i=0; i != 512; ++i) {
-        buf[i] = peek(buffer+i);
-    }
-
-    errno = 0;
-    if (fwrite(buf, 1, 512, d->fh) < 512) {
-        int err = errno;
-        DIE(1, "Couldn't write 512 bytes at offset %zu in hdd \"%s\": %s.\n",
-            (size_t)sekpos, d->fname, strerror(err));
+    trace_disk(TD_HDD_WRITE, unit, blkpos);
+    if (stats_on) {
+        ++counters.hdd_blocks_written;
+        count_cached(d, sekpos);
+    }
+    timing_io_signal(ACCEL_BLOCK_IO);
+
+    // Straight into the image. The buffer may cross into as many as
+    //  three different regions of memory; mem_dma_read() sees to that.
+    mem_dma_read(buffer, d->buf + sekpos, 512);
+
+    if (sync_policy == SYNC_ALWAYS) {
+        sync_range(d, sekpos, sekpos + 512, MS_SYNC);
+    } else if (sync_policy == SYNC_IDLE) {
+        bool was_clean = true;
+        for (struct SPDev *e = devices; e != devices + ndev; ++e) {
+            if (e->dirty_lo != e->dirty_hi) was_clean = false;
+        }
+        if (was_clean) dirty_since = frame_count;
+        extend(&d->dirty_lo, &d->dirty_hi, sekpos);
+        extend(&d->unsynced_lo, &d->unsynced_hi, sekpos);
+        // Put off the flush while writes keep coming - but not forever.
+        if (frame_count - dirty_since < SYNC_MAX_FRAMES) {
+            frame_timer(SYNC_FRAMES, flush_images);
+        }
+    } else {
+        extend(&d->unsynced_lo, &d->unsynced_hi, sekpos);
     }
 
     PPUT(PCARRY, false);
@@ -234,49 +346,33 @@ static void read_block(byte unit, off_t blkpos, word buffer)
     if (unit == 0 || unit > ndev) {
         WARN("Bad read_black unit number %d\n", (int)unit);
         RETURN_ERROR(DevDiscon);
+        return;
     }
 
     if (buffer > 0x10000 - 512) {
         WARN("Bad buffer $%04lX provided to read_block\n",
              (unsigned long)buffer);
         RETURN_ERROR(BadBuf);
+        return;
     }
 
     struct SPDev *d = &devices[unit-1];
-    off_t sekpos = blkpos * 512;
+    if (!block_ok(d, blkpos)) return;
+    size_t sekpos = blkpos * 512;
     size_t newloc;
     mem_get_true_access(buffer, true /* writing */,
                         &newloc, NULL, NULL);
     DEBUG("read_block, unit=%d, blk=%zu, buf=%04lX, REALbuf=%04zX\n", (int)unit,
           (size_t)blkpos, (unsigned long)buffer, newloc);
-    errno = 0;
-    DEBUG("fseeko(\"%s\", %zu, SEEK_SET)\n", d->fname, (size_t)sekpos);
-    if (fseeko(d->fh, sekpos, SEEK_SET) < 0) {
-        int err = errno;
-        WARN("Bad smartport block requested for \"%s\", offset %zu: %s.\n",
-             d->fname, (size_t)sekpos, strerror(err));
-        RETURN_ERROR(BadBlock);
+    trace_disk(TD_HDD_READ, unit, blkpos);
+    if (stats_on) {
+        ++counters.hdd_blocks_read;
+        count_cached(d, sekpos);
     }
+    timing_io_signal(ACCEL_BLOCK_IO);
 
-    byte buf[512];
-    errno = 0;
-    if (fread(buf, 1, 512, d->fh) < 512) {
-        int err = errno;
-        DIE(1, "Couldn't read 512 bytes at offset %zu in hdd \"%s\": %s.\n",
-            (size_t)sekpos, d->fname, strerror(err));
-    }
-#if 0
-    DEBUG("fread BUFFER: %02X %02X %02X %02X %02X %02X %02X %02X\n",
-          buf[0], buf[1], buf[2], buf[3], buf[4], buf[5], buf[6], buf[7]);
-#endif
-    // We do an inefficient loop bc it's an easy way
-    // to ensure everything goes where it actually ought to, in the case
-    // of crossing mapping boundaries (up to 3 different regions of
-    // memory are possible)
-    for (word i=0; i != 512; ++i) {
-        poke(buffer+i, buf[i]);
-    }
-    //mem_put(buf, newloc, 512);
+    // Straight from the image (see write_block()).
+    mem_dma_write(buffer, d->buf + sekpos, 512);
 
     PPUT(PCARRY, false);
 }
@@ -296,6 +392,7 @@ static void handle_sp_rw_block(word params, bool rw)
              rw == SP_DO_READ? "read" : "write",
              (int)pcount);
         RETURN_ERROR(BadPCnt);
+        return;
     }
 
     off_t blkpos = (blkhi << 16) | (blkmd << 8) | blklo;
@@ -486,6 +583,8 @@ static void handle_event(Event *e)
     if (e->type != EV_PRESTEP)
         return;
 
+    // (log_ripple() needs a handler registered for every EV_PRESTEP,
+    //  not just these PC hooks.)
     //log_ripple();
 
     // For now, assume slot is always slot 5
@@ -508,28 +607,32 @@ static void init(void)
     if (!cfg.hdd_set)
         return;
 
+    const char *p = cfg.hdd_sync? cfg.hdd_sync : "idle";
+    if (STREQ(p, "always")) {
+        sync_policy = SYNC_ALWAYS;
+    } else if (STREQ(p, "idle")) {
+        sync_policy = SYNC_IDLE;
+    } else if (STREQ(p, "exit")) {
+        sync_policy = SYNC_EXIT;
+    } else {
+        DIE(2, "--hdd-sync: expected always, idle, or exit, not \"%s\".\n",
+            p);
+    }
+    pagesz = sysconf(_SC_PAGESIZE);
+
     for (struct SPDev *d = devices; d != devices + ndev; ++d) {
-        errno = 0;
-        d->fh = fopen(d->fname, "rb+");
-        int err = errno;
-        if (!d->fh) {
+        int err = mmapfile(d->fname, &d->buf, &d->sz, O_RDWR);
+        if (err != 0) {
             DIE(1, "Couldn't open hdd file \"%s\": %s\n", d->fname,
                 strerror(err));
         }
+        d->dirty_lo = d->dirty_hi = 0;
+        d->unsynced_lo = d->unsynced_hi = 0;
 
-        int fd = fileno(d->fh);
-        errno = 0;
-        struct stat s;
-        if (fstat(fd, &s) < 0) {
-            err = errno;
-            DIE(1, "Couldn't stat hdd file \"%s\": %s\n", d->fname,
-                strerror(err));
-        }
-
-        d->sz = s.st_size;
         unsigned long bcount = d->sz / 512;
         if (bcount * 512 != d->sz) {
-            DIE(1, "HDD image file \"%s\" is not a multiple of 512 in length.\n");
+            DIE(1, "HDD image file \"%s\" is not a multiple of 512 in length.\n",
+                d->fname);
         }
         for (int i=0; i!=3; ++i) {
             d->bsz[i] = bcount & 0xFF;
@@ -537,7 +640,11 @@ static void init(void)
         }
     }
 
-    event_reghandler(handle_event);
+    atexit(sync_images);
+
+    event_pc_hook(EV_PRESTEP, 0xC500, handle_event);
+    event_pc_hook(EV_PRESTEP, 0xC500 | smartport_ep, handle_event);
+    event_pc_hook(EV_PRESTEP, 0xC500 | prodos_ep, handle_event);
 }
 
 static byte handler(word loc, int val, int ploc, int psw)
@@ -0,0 +1,308 @@
+//  profile.c
+//
+//  Copyright (c) 2025 Micah John Cowan.
+//  This code is licensed under the MIT license.
+//  See the accompanying LICENSE file for details.
+
+//  --profile: count the instructions executed and the cycles they
+//  took, for every location, and the calls made to each subroutine
+//  (and from where). The report is written out at exit.
+//
+//  Counts are kept per *slot*, rather than per address, so that code
+//  in aux memory, the language card banks, and the firmware, are all
+//  counted apart from whatever main-memory code shares their
+//  addresses. A slot is the instruction's offset in the RAM buffer
+//  (whose aux half, and whose $C000 page for language card bank 1,
+//  takes care of those), or, for the firmware, its address in a third
+//  64k region. Each page's slot base is worked out once per change of
+//  the memory map, so that counting an instruction is just a few
+//  array updates.
+
+#include "bobbin-internal.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NSLOTS      (3 * 0x10000)
+#define FW_BASE     (2 * 0x10000)   // ROM, slot ROMs
+#define NO_SLOT     UINT32_MAX
+
+// Each (caller, callee) pair of subroutines is an arc of the call
+//  graph. Arcs live in a fixed-size hash table, so that nothing is
+//  allocated while the machine runs.
+#define NARCS       8192
+#define MAX_DEPTH   128     // a JSR uses two bytes of the 256-byte stack
+
+struct slotstat {
+    uintmax_t   instrs;
+    uintmax_t   cycles;
+};
+
+struct arc {
+    uint32_t    caller;     // entry slot of the caller, or NO_SLOT
+    uint32_t    callee;     // entry slot of the subroutine
+    uintmax_t   calls;
+    uintmax_t   cycles;     // spent within the callee, and its callees
+};
+
+struct frame {
+    struct arc *arc;
+    byte        sp;         // SP after the JSR
+    uintmax_t   start;
+};
+
+bool profiling = false;
+
+static struct slotstat *stats;
+static byte (*code)[3];     // instruction bytes, as first executed
+static struct arc *arcs;
+static unsigned long narcs = 0;
+static uintmax_t arcs_dropped = 0;
+static struct frame frames[MAX_DEPTH];
+static unsigned int depth = 0;
+static uintmax_t total_cycles = 0;
+static uintmax_t total_instrs = 0;
+
+static uint32_t page_base[0x100];
+static unsigned long page_gen[0x100]; // 0 is never a valid cpu_cache_gen
+
+static uint32_t slot_of(word pc)
+{
+    byte pg = HI(pc);
+    if (page_gen[pg] != cpu_cache_gen) {
+        size_t bufloc;
+        MemAccessType acc;
+        mem_get_true_access(pg << 8, false, &bufloc, NULL, &acc);
+        page_base[pg] = (acc == MA_ROM || acc == MA_SLOTS)?
+            FW_BASE + (pg << 8) : bufloc;
+        page_gen[pg] = cpu_cache_gen;
+    }
+    return page_base[pg] + LO(pc);
+}
+
+static struct arc *find_arc(uint32_t caller, uint32_t callee)
+{
+    unsigned long h = (caller * 31u + callee) % NARCS;
+    for (unsigned long i = 0; i != NARCS; ++i) {
+        struct arc *a = &arcs[(h + i) % NARCS];
+        if (a->calls == 0) {
+            if (narcs == NARCS / 2) return NULL; // keep probes short
+            ++narcs;
+            a->caller = caller;
+            a->callee = callee;
+            return a;
+        }
+        if (a->caller == caller && a->callee == callee) return a;
+    }
+    return NULL;
+}
+
+void profile_begin(ProfileMark *m)
+{
+    m->slot = slot_of(PC);
+    m->sp = SP;
+    m->cycles = cycle_count;
+    if (stats[m->slot].instrs == 0) {
+        for (int i = 0; i != 3; ++i) {
+            code[m->slot][i] = peek_sneaky(PC + i);
+        }
+    }
+}
+
+void profile_end(const ProfileMark *m)
+{
+    uintmax_t cycles = cycle_count - m->cycles;
+    struct slotstat *s = &stats[m->slot];
+    ++s->instrs;
+    s->cycles += cycles;
+    ++total_instrs;
+    total_cycles += cycles;
+
+    if (SP == m->sp) return;
+    if (SP == LO(m->sp - 2)) {
+        // A JSR (nothing else pushes exactly two bytes).
+        uint32_t callee = slot_of(PC);
+        uint32_t caller = depth? frames[depth-1].arc->callee : NO_SLOT;
+        struct arc *a = find_arc(caller, callee);
+        if (a == NULL) {
+            ++arcs_dropped;
+            return;
+        }
+        ++a->calls;
+        if (depth != MAX_DEPTH) {
+            frames[depth++] = (struct frame){ a, SP, total_cycles };
+        }
+    } else {
+        // Returns (and anything else that pops the stack) end any
+        //  calls whose return address is no longer on it.
+        while (depth && frames[depth-1].sp + 2 <= SP) {
+            struct frame *f = &frames[--depth];
+            f->arc->cycles += total_cycles - f->start;
+        }
+    }
+}
+
+/********** Report **********/
+
+// The address and memory bank of a slot.
+static const char *slot_bank(uint32_t slot, word *loc)
+{
+    *loc = slot & 0xFFFF;
+    if (slot >= FW_BASE) {
+        return *loc < LOC_ROM_START? "I/O" : "ROM";
+    }
+    bool aux = slot & LOC_AUX_START;
+    if (*loc >= LOC_BSR1_START && *loc < LOC_BSR1_END) {
+        *loc += LOC_BSR_START - LOC_BSR1_START;
+        return aux? "aux LC1" : "LC1";
+    } else if (*loc >= LOC_BSR2_START && *loc < LOC_BSR2_END) {
+        return aux? "aux LC2" : "LC2";
+    } else if (*loc >= LOC_BSR2_END) {
+        return aux? "aux LC" : "LC";
+    }
+    return aux? "aux" : "main";
+}
+
+// e.g. "D000 aux LC1". Returns a static buffer.
+static const char *slot_name(uint32_t slot)
+{
+    static char buf[32];
+    if (slot == NO_SLOT) {
+        return "(top level)";
+    }
+    word loc;
+    const char *bank = slot_bank(slot, &loc);
+    snprintf(buf, sizeof buf, "%04X %s", loc, bank);
+    return buf;
+}
+
+static double pct(uintmax_t n)
+{
+    return total_cycles? 100.0 * n / total_cycles : 0.0;
+}
+
+static int by_cycles(const void *va, const void *vb)
+{
+    uintmax_t a = stats[*(const uint32_t *)va].cycles;
+    uintmax_t b = stats[*(const uint32_t *)vb].cycles;
+    return a < b? 1 : a > b? -1 : 0;
+}
+
+static int arc_by_cycles(const void *va, const void *vb)
+{
+    const struct arc *a = va, *b = vb;
+    return a->cycles < b->cycles? 1 : a->cycles > b->cycles? -1
+        : a->calls < b->calls? 1 : a->calls > b->calls? -1 : 0;
+}
+
+static void report_instrs(FILE *f)
+{
+    uint32_t *order = xalloc(NSLOTS * sizeof order[0]);
+    size_t n = 0;
+    for (uint32_t slot = 0; slot != NSLOTS; ++slot) {
+        if (stats[slot].instrs != 0) order[n++] = slot;
+    }
+    qsort(order, n, sizeof order[0], by_cycles);
+
+    fprintf(f, "Instructions, by cycles taken:\n\n");
+    fprintf(f, "%14s %7s %12s  %-7s  %s\n",
+            "cycles", "%", "executed", "bank", "instruction");
+    for (size_t i = 0; i != n; ++i) {
+        uint32_t slot = order[i];
+        DisasmSnap d = { .nacc = 0 };
+        const char *bank = slot_bank(slot, &d.pc);
+        memcpy(d.m, code[slot], sizeof d.m);
+        fprintf(f, "%14ju %6.2f%% %12ju  %-7s  ", stats[slot].cycles,
+                pct(stats[slot].cycles), stats[slot].instrs, bank);
+        disasm_print_snap(f, &d);
+    }
+    free(order);
+}
+
+static void report_calls(FILE *f)
+{
+    // Collect the arcs at the front of the table, most costly first.
+    size_t n = 0;
+    for (size_t i = 0; i != NARCS; ++i) {
+        if (arcs[i].calls != 0) arcs[n++] = arcs[i];
+    }
+    qsort(arcs, n, sizeof arcs[0], arc_by_cycles);
+
+    // A subroutine's totals are those of every arc into it. Gather
+    //  them into the (now unused) back of the table.
+    struct arc *subs = arcs + n;
+    size_t nsubs = 0;
+    for (size_t i = 0; i != n; ++i) {
+        size_t j = 0;
+        while (j != nsubs && subs[j].callee != arcs[i].callee) ++j;
+        if (j == nsubs) {
+            subs[nsubs++] = (struct arc){ NO_SLOT, arcs[i].callee, 0, 0 };
+        }
+        subs[j].calls += arcs[i].calls;
+        subs[j].cycles += arcs[i].cycles;
+    }
+    qsort(subs, nsubs, sizeof subs[0], arc_by_cycles);
+
+    fprintf(f, "\nSubroutines, by cycles spent within them"
+               " (and the subroutines they call):\n\n");
+    fprintf(f, "%14s %7s %12s  %s\n", "cycles", "%", "calls", "entry");
+    for (size_t i = 0; i != nsubs; ++i) {
+        fprintf(f, "%14ju %6.2f%% %12ju  %s\n", subs[i].cycles,
+                pct(subs[i].cycles), subs[i].calls, slot_name(subs[i].callee));
+    }
+
+    fprintf(f, "\nCall graph, by cycles spent in each call:\n\n");
+    fprintf(f, "%14s %7s %12s  %-13s    %s\n",
+            "cycles", "%", "calls", "caller", "callee");
+    for (size_t i = 0; i != n; ++i) {
+        const struct arc *a = &arcs[i];
+        fprintf(f, "%14ju %6.2f%% %12ju  %-13s -> ", a->cycles,
+                pct(a->cycles), a->calls, slot_name(a->caller));
+        fprintf(f, "%s\n", slot_name(a->callee));
+    }
+    if (arcs_dropped != 0) {
+        fprintf(f, "\n(%ju calls not shown: too many distinct"
+                   " caller/callee pairs.)\n", arcs_dropped);
+    }
+}
+
+static void profile_report(void)
+{
+    profiling = false;
+    // Calls still underway count up to now.
+    while (depth) {
+        struct frame *fr = &frames[--depth];
+        fr->arc->cycles += total_cycles - fr->start;
+    }
+
+    errno = 0;
+    FILE *f = fopen(cfg.profile_file, "w");
+    if (f == NULL) {
+        WARN("--profile: couldn't open \"%s\": %s\n", cfg.profile_file,
+             strerror(errno));
+        return;
+    }
+    fprintf(f, "bobbin profile: %ju instructions, %ju cycles.\n\n",
+            total_instrs, total_cycles);
+    report_instrs(f);
+    report_calls(f);
+    if (fclose(f) != 0) {
+        WARN("--profile: couldn't write \"%s\": %s\n", cfg.profile_file,
+             strerror(errno));
+    }
+}
+
+void profile_init(void)
+{
+    if (!cfg.profile_file) return;
+
+    stats = xalloc(NSLOTS * sizeof stats[0]);
+    memset(stats, 0, NSLOTS * sizeof stats[0]);
+    code = xalloc(NSLOTS * sizeof code[0]);
+    arcs = xalloc(NARCS * sizeof arcs[0]);
+    memset(arcs, 0, NARCS * sizeof arcs[0]);
+    profiling = true;
+    atexit(profile_report);
+}
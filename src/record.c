@@ -0,0 +1,239 @@
+//  record.c
+//
+//  Copyright (c) 2025 Micah John Cowan.
+//  This code is licensed under the MIT license.
+//  See the accompanying LICENSE file for details.
+
+//  --record, --replay: a session's input, kept in a file, so that the
+//  session can be run again exactly as it went the first time.
+//
+//  The machine itself is deterministic; what isn't is what it's given
+//  from outside. That's what the interface answers when the machine
+//  reads the keyboard (and the other locations the interface looks
+//  after), and the reboots --watch does when a file changes. Those
+//  are what's recorded, each with the instruction count it happened
+//  at. A location's value is only recorded when it changes: a program
+//  waiting on a key reads the same "nothing yet" thousands of times.
+//
+//  On replay, the interface is kept away from the keyboard, and every
+//  read of a recorded location gets what it got the first time round,
+//  whichever interface it was that answered it then.
+//  The file is read in full up front, so that nothing is allocated or
+//  read while the machine runs.
+//
+//  The file is text, a line per event:
+//
+//      bobbin-record 1
+//      1234567 peek C000 C1
+//      1234590 peek C000 41
+//      2345678 reboot
+//      3456789 end
+
+#include "bobbin-internal.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define RECORD_HEADER   "bobbin-record 1"
+#define NO_VAL          (-2)    // not e->val's "nothing to say" of -1
+
+enum rec_type {
+    REC_PEEK,
+    REC_REBOOT,
+    REC_END,
+};
+
+struct rec {
+    uintmax_t       instrs;
+    enum rec_type   type;
+    word            loc;
+    int             val;
+};
+
+bool record_on = false;
+bool replay_on = false;
+
+static FILE *recf;
+static struct rec *recs;
+static size_t nrecs = 0;
+static size_t next = 0;
+static int last[0x100];         // each I/O location's value, as of now
+
+// A location we've something to say about. Interfaces only handle the
+//  soft switches.
+static int *last_of(word loc)
+{
+    return HI(loc) == HI(SS_START)? &last[LO(loc)] : NULL;
+}
+
+/********** Recording **********/
+
+static void record_end(void)
+{
+    fprintf(recf, "%ju end\n", instr_count);
+    errno = 0;
+    if (fclose(recf) != 0) {
+        WARN("--record: couldn't write \"%s\": %s\n", cfg.record_file,
+             strerror(errno));
+    }
+}
+
+static void record_start(void)
+{
+    errno = 0;
+    recf = fopen(cfg.record_file, "w");
+    if (recf == NULL) {
+        DIE(1, "--record: couldn't open \"%s\": %s\n", cfg.record_file,
+            strerror(errno));
+    }
+    fprintf(recf, "%s\n", RECORD_HEADER);
+    record_on = true;
+    atexit(record_end);
+}
+
+void record_reboot(void)
+{
+    if (record_on) fprintf(recf, "%ju reboot\n", instr_count);
+}
+
+/********** Replaying **********/
+
+static void replay_load(void)
+{
+    errno = 0;
+    FILE *f = fopen(cfg.replay_file, "r");
+    if (f == NULL) {
+        DIE(1, "--replay: couldn't open \"%s\": %s\n", cfg.replay_file,
+            strerror(errno));
+    }
+
+    char line[80];
+    unsigned long lineno = 1;
+    if (fgets(line, sizeof line, f) == NULL
+        || strcmp(line, RECORD_HEADER "\n") != 0) {
+        DIE(1, "--replay: \"%s\" isn't a bobbin recording.\n",
+            cfg.replay_file);
+    }
+    size_t cap = 0;
+    while (fgets(line, sizeof line, f) != NULL) {
+        ++lineno;
+        struct rec r = { .loc = 0, .val = NO_VAL };
+        char what[8];
+        char val[4];
+        unsigned int loc;
+        int n = sscanf(line, "%ju %7s %x %3s", &r.instrs, what, &loc, val);
+        if (n == 4 && STREQ(what, "peek") && last_of(loc) != NULL) {
+            r.type = REC_PEEK;
+            r.loc = loc;
+            r.val = STREQ(val, "-")? -1 : (int) strtol(val, NULL, 16);
+            // The interface that made the recording may have watched
+            //  locations that ours doesn't (tty's buttons, say).
+            event_watch(EV_PEEK, r.loc, r.loc);
+        } else if (n == 2 && STREQ(what, "reboot")) {
+            r.type = REC_REBOOT;
+        } else if (n == 2 && STREQ(what, "end")) {
+            r.type = REC_END;
+        } else {
+            DIE(1, "--replay: \"%s\", line %lu: bad event.\n",
+                cfg.replay_file, lineno);
+        }
+        if (nrecs != 0 && r.instrs < recs[nrecs - 1].instrs) {
+            DIE(1, "--replay: \"%s\", line %lu: out of order.\n",
+                cfg.replay_file, lineno);
+        }
+        if (nrecs == cap) {
+            cap = cap? 2 * cap : 1024;
+            struct rec *n = xalloc(cap * sizeof n[0]);
+            memcpy(n, recs, nrecs * sizeof n[0]);
+            free(recs);
+            recs = n;
+        }
+        recs[nrecs++] = r;
+        if (r.type == REC_END) break;
+    }
+    if (ferror(f) || nrecs == 0 || recs[nrecs - 1].type != REC_END) {
+        DIE(1, "--replay: \"%s\" is cut short.\n", cfg.replay_file);
+    }
+    fclose(f);
+    replay_on = true;
+}
+
+static void replay_done(void)
+{
+    INFO("--replay: end of the recording, at instruction %ju.\n",
+         instr_count);
+    exit(0);
+}
+
+static void out_of_step(void)
+{
+    DIE(1, "--replay: the machine has gone out of step with the"
+        " recording, at instruction %ju.\n", instr_count);
+}
+
+bool replay_reboot_due(void)
+{
+    if (!replay_on || recs[next].type != REC_REBOOT
+        || recs[next].instrs != instr_count) {
+        return false;
+    }
+    ++next;
+    INFO("--replay: rebooting, as recorded.\n");
+    event_fire(EV_REBOOT);
+    return true;
+}
+
+static void replay_frame(Event *e)
+{
+    const struct rec *r = &recs[next];
+    if (r->type == REC_END && instr_count >= r->instrs) {
+        replay_done();
+    } else if (r->type != REC_END && r->instrs < instr_count) {
+        out_of_step();
+    }
+}
+
+/**********/
+
+void record_peek(Event *e)
+{
+    int *lastp = last_of(e->loc);
+    if (lastp == NULL) return;
+    if (record_on) {
+        if (e->val == *lastp) return;
+        *lastp = e->val;
+        if (e->val < 0) {
+            fprintf(recf, "%ju peek %04X -\n", instr_count, e->loc);
+        } else {
+            fprintf(recf, "%ju peek %04X %02X\n", instr_count, e->loc,
+                    (unsigned int) e->val);
+        }
+        return;
+    }
+
+    const struct rec *r = &recs[next];
+    if (r->type == REC_PEEK && r->instrs == instr_count && r->loc == e->loc) {
+        *lastp = r->val;
+        ++next;
+    } else if (r->type == REC_END && instr_count >= r->instrs) {
+        replay_done();
+    } else if (r->instrs < instr_count || *lastp == NO_VAL) {
+        out_of_step();
+    }
+    e->val = *lastp;
+}
+
+void record_init(void)
+{
+    for (size_t i = 0; i != sizeof last / sizeof last[0]; ++i) {
+        last[i] = NO_VAL;
+    }
+    if (cfg.record_file) {
+        record_start();
+    } else if (cfg.replay_file) {
+        replay_load();
+        event_reghandler(replay_frame, EVMASK(EV_FRAME));
+    }
+}
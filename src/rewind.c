@@ -0,0 +1,377 @@
+//  rewind.c
+//
+//  Copyright (c) 2025 Micah John Cowan.
+//  This code is licensed under the MIT license.
+//  See the accompanying LICENSE file for details.
+
+//  --rewind: the history behind the debugger's reverse-step and
+//  reverse-continue (rs, rc).
+//
+//  Every --rewind-interval frames, we take a checkpoint of the
+//  machine: its registers and soft switches, and the RAM pages that
+//  have changed since the last checkpoint. Each checkpoint keeps the
+//  pages' *previous* contents, and a shadow copy of RAM holds the
+//  machine as of the latest checkpoint, so that getting back to any
+//  checkpoint is a matter of starting from the shadow and undoing
+//  each later checkpoint's changes in turn. The oldest checkpoints are
+//  dropped to keep within --rewind megabytes.
+//
+//  Anything the machine reads that doesn't follow from its own state
+//  - keys, and the like, from the interface, and everything read from
+//  the peripheral cards' I/O locations (the bytes coming off a disk) -
+//  is logged as it's read. Going back to a given instruction means
+//  restoring the last checkpoint before it, then replaying from there:
+//  while replaying, those reads are answered from the log instead,
+//  the interface is left out of things altogether, and the cards
+//  aren't touched; nor do the frame timers (the Disk ][ motor's, say)
+//  run down, since they were set going in the present. Once the
+//  replay catches up with where the machine had got to, it carries
+//  on live from there.
+//
+//  Changing the machine by hand mid-replay has it carry on live from
+//  where the replay had got to instead, and the Disk ][ controller
+//  has to be put back as it was there. Each checkpoint keeps the
+//  controller's state, which is good for as long as the replay hasn't
+//  skipped any card I/O since; and only while the drive is stopped,
+//  since there's no putting a spinning disk back. Otherwise, the
+//  change is refused.
+//
+//  Hard disk blocks are read straight from the image, even during a
+//  replay; a block written after a checkpoint is seen, replaying from
+//  that checkpoint, as it is now.
+
+#include "bobbin-internal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NPAGES      (MEM_RAM_SIZE / 0x100)
+
+struct page {
+    uint16_t    num;
+    byte        data[0x100];
+};
+
+struct checkpoint {
+    uintmax_t       instrs;     // instr_count when taken
+    uintmax_t       frames;
+    uintmax_t       inputs;     // log position
+    Registers       regs;
+    SoftSwitches    sw;
+    Disk2State      disk;
+    bool            disk_busy;  // the drive was spinning
+    size_t          npages;
+    struct page     *pages;     // as they were at the previous checkpoint
+};
+
+// A run of identical reads in the input log.
+struct input_run {
+    uintmax_t   start;          // log position of the first
+    uint32_t    count;
+    int16_t     val;
+};
+
+bool rewind_on = false;
+bool rewind_replaying = false;
+
+static byte *shadow;            // RAM, as of checkpoint `base`
+static byte *scratch;
+
+// Checkpoints, oldest first, in a ring.
+static struct checkpoint *ckpts;
+static size_t ck_cap = 0;
+static size_t ck_first = 0;
+static size_t ck_n = 0;
+static size_t base;             // the latest, at or before where we are
+
+static struct input_run *log_runs;
+static size_t log_cap = 0;
+static size_t log_n = 0;
+static uintmax_t log_end = 0;   // position after the last logged read
+static uintmax_t log_pos = 0;   // where replay reads next
+
+static uintmax_t head;          // the furthest instr_count reached
+static bool cards_skipped;      // since checkpoint `base`, in this replay
+static size_t bytes_used = 0;
+static size_t budget;
+
+static struct checkpoint *ck(size_t i)
+{
+    return &ckpts[(ck_first + i) % ck_cap];
+}
+
+static size_t ck_size(const struct checkpoint *c)
+{
+    return sizeof *c + c->npages * sizeof c->pages[0];
+}
+
+static void ck_free_pages(struct checkpoint *c)
+{
+    bytes_used -= c->npages * sizeof c->pages[0];
+    free(c->pages);
+    c->pages = NULL;
+    c->npages = 0;
+}
+
+/********** Input log **********/
+
+// The run that holds log position POS.
+static size_t run_at(uintmax_t pos)
+{
+    size_t lo = 0, hi = log_n;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (log_runs[mid].start <= pos) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static void log_append(int val)
+{
+    struct input_run *r = log_n? &log_runs[log_n - 1] : NULL;
+    if (r && r->val == val && r->count != UINT32_MAX) {
+        ++r->count;
+    } else {
+        if (log_n == log_cap) {
+            size_t cap = log_cap? 2 * log_cap : 1024;
+            struct input_run *runs = xalloc(cap * sizeof runs[0]);
+            memcpy(runs, log_runs, log_n * sizeof runs[0]);
+            free(log_runs);
+            log_runs = runs;
+            bytes_used += (cap - log_cap) * sizeof runs[0];
+            log_cap = cap;
+        }
+        log_runs[log_n++] = (struct input_run){ log_end, 1, val };
+    }
+    ++log_end;
+    log_pos = log_end;
+}
+
+// Forget everything logged from POS on.
+static void log_truncate(uintmax_t pos)
+{
+    if (log_n == 0) return;
+    size_t i = run_at(pos);
+    struct input_run *r = &log_runs[i];
+    if (pos < r->start) {
+        log_n = 0;
+    } else {
+        r->count = pos - r->start;
+        log_n = r->count? i + 1 : i;
+    }
+    log_end = log_pos = pos;
+}
+
+// Forget everything logged before POS.
+static void log_discard_before(uintmax_t pos)
+{
+    if (log_n == 0) return;
+    size_t i = run_at(pos);
+    memmove(log_runs, &log_runs[i], (log_n - i) * sizeof log_runs[0]);
+    log_n -= i;
+}
+
+int rewind_input(int val)
+{
+    if (!rewind_replaying) {
+        log_append(val);
+        return val;
+    }
+    if (log_pos == log_end) {
+        // Can't happen: replay stops before it runs out of log.
+        return val;
+    }
+    const struct input_run *r = &log_runs[run_at(log_pos)];
+    ++log_pos;
+    return r->val;
+}
+
+void rewind_card_skipped(void)
+{
+    cards_skipped = true;
+}
+
+/********** Checkpoints **********/
+
+static void drop_oldest(void)
+{
+    struct checkpoint *c = ck(0);
+    ck_free_pages(c);
+    ck_first = (ck_first + 1) % ck_cap;
+    --ck_n;
+    --base;
+    // The new oldest's pages would only take us back before it.
+    ck_free_pages(ck(0));
+    log_discard_before(ck(0)->inputs);
+}
+
+static void forget_all(void)
+{
+    while (ck_n) {
+        ck_free_pages(ck(ck_n - 1));
+        --ck_n;
+    }
+    ck_first = 0;
+    log_n = 0;
+    log_end = log_pos = 0;
+    rewind_replaying = false;
+}
+
+static void take_checkpoint(void)
+{
+    if (ck_n == ck_cap) {
+        size_t cap = ck_cap? 2 * ck_cap : 64;
+        struct checkpoint *n = xalloc(cap * sizeof n[0]);
+        for (size_t i = 0; i != ck_n; ++i) n[i] = *ck(i);
+        free(ckpts);
+        ckpts = n;
+        ck_first = 0;
+        bytes_used += (cap - ck_cap) * sizeof n[0];
+        ck_cap = cap;
+    }
+
+    const byte *ram = getram();
+    struct checkpoint *c = ck(ck_n);
+    c->instrs = instr_count;
+    c->frames = frame_count;
+    c->inputs = log_end;
+    c->regs = theCpu.regs;
+    memcpy(c->sw, ss, sizeof c->sw);
+    disk2_get_state(&c->disk);
+    c->disk_busy = drive_spinning();
+    c->npages = 0;
+    c->pages = NULL;
+    if (ck_n != 0) {
+        size_t n = 0;
+        for (size_t p = 0; p != NPAGES; ++p) {
+            if (memcmp(&ram[p << 8], &shadow[p << 8], 0x100) != 0) ++n;
+        }
+        if (n) c->pages = xalloc(n * sizeof c->pages[0]);
+        for (size_t p = 0; p != NPAGES; ++p) {
+            if (memcmp(&ram[p << 8], &shadow[p << 8], 0x100) == 0) continue;
+            struct page *pg = &c->pages[c->npages++];
+            pg->num = p;
+            memcpy(pg->data, &shadow[p << 8], 0x100);
+        }
+        bytes_used += c->npages * sizeof c->pages[0];
+    }
+    memcpy(shadow, ram, MEM_RAM_SIZE);
+    base = ck_n++;
+
+    while (bytes_used > budget && ck_n > 1) {
+        drop_oldest();
+    }
+}
+
+// Back to checkpoint I, which is at or before `base`.
+static void restore(size_t i)
+{
+    memcpy(scratch, shadow, MEM_RAM_SIZE);
+    for (size_t j = base; j != i; --j) {
+        const struct checkpoint *c = ck(j);
+        for (size_t k = 0; k != c->npages; ++k) {
+            memcpy(&scratch[c->pages[k].num << 8], c->pages[k].data, 0x100);
+        }
+    }
+    byte *tmp = shadow;
+    shadow = scratch;
+    scratch = tmp;
+    base = i;
+
+    const struct checkpoint *c = ck(i);
+    mem_restore(shadow, c->sw);
+    theCpu.regs = c->regs;
+    instr_count = c->instrs;
+    frame_count = c->frames;
+    cycle_count = 0;
+    log_pos = c->inputs;
+    cards_skipped = false;
+    rewind_replaying = true;
+}
+
+bool rewind_restore(uintmax_t instrs, uintmax_t *at)
+{
+    if (!rewind_on || ck_n == 0 || ck(0)->instrs > instrs) return false;
+    if (!rewind_replaying) head = instr_count;
+    size_t i = base;
+    while (ck(i)->instrs > instrs) --i;
+    restore(i);
+    *at = instr_count;
+    return true;
+}
+
+uintmax_t rewind_oldest(void)
+{
+    return ck_n? ck(0)->instrs : instr_count;
+}
+
+void rewind_step(void)
+{
+    if (instr_count < head) return;
+    // Caught up with the present.
+    rewind_replaying = false;
+    event_fire(EV_DISPLAY_TOUCH);
+}
+
+bool rewind_diverge(void)
+{
+    if (!rewind_replaying) return true;
+    const struct checkpoint *c = ck(base);
+    if (c->disk_busy || cards_skipped || !disk2_spin_down()) return false;
+    disk2_set_state(&c->disk);
+
+    // What was recorded from here on didn't happen, after all.
+    while (ck_n - 1 > base) {
+        ck_free_pages(ck(ck_n - 1));
+        --ck_n;
+    }
+    log_truncate(log_pos);
+    head = instr_count;
+    rewind_replaying = false;
+    return true;
+}
+
+static void rewind_event(Event *e)
+{
+    switch (e->type) {
+        case EV_FRAME:
+            if (frame_count % cfg.rewind_interval != 0) break;
+            if (!rewind_replaying) {
+                take_checkpoint();
+            } else if (base + 1 != ck_n && ck(base + 1)->instrs == instr_count) {
+                // Passing a checkpoint we took the first time through.
+                memcpy(shadow, getram(), MEM_RAM_SIZE);
+                ++base;
+                cards_skipped = false;
+            }
+            break;
+        case EV_RESET:
+        case EV_REBOOT:
+        case EV_STATE_LOAD:
+            // The machine can't be replayed through these; history
+            //  starts over.
+            (void) rewind_diverge();
+            forget_all();
+            break;
+        default:
+            ;
+    }
+}
+
+void rewind_init(void)
+{
+    if (cfg.rewind_mb == 0) return;
+    if (cfg.rewind_interval == 0) {
+        DIE(2, "--rewind-interval must be at least 1.\n");
+    }
+    budget = cfg.rewind_mb * 1024 * 1024;
+    shadow = xalloc(MEM_RAM_SIZE);
+    scratch = xalloc(MEM_RAM_SIZE);
+    event_reghandler(rewind_event, EVMASK(EV_FRAME) | EVMASK(EV_RESET)
+                     | EVMASK(EV_REBOOT) | EVMASK(EV_STATE_LOAD));
+    rewind_on = true;
+}
@@ -18,7 +18,9 @@ BEGIN {
     print
     print "// this file is read by config.c."
     print
-    print "static const char help_text[] = "
+    # One string per section: C99 only promises string literals of
+    # up to 4095 chars, and the whole text is longer than that.
+    print "static const char * const help_text[] = {"
 }
 
 1 {
@@ -69,6 +71,7 @@ NEED_DESC && !/^$/ {
 }
 
 STARTED && /^#### / {
+    print "    ,"
     sub(/^#### /,"")
     gsub("\"","")
     $0 = toupper($0)
@@ -101,7 +104,8 @@ OUTPUT {
 }
 
 /^<!--END-OPTIONS-->/ {
-    print ";"
+    print "    , NULL"
+    print "};"
     exit(0);
 }
 
@@ -0,0 +1,227 @@
+//  serve.c
+//
+//  Copyright (c) 2025 Micah John Cowan.
+//  This code is licensed under the MIT license.
+//  See the accompanying LICENSE file for details.
+
+//  --serve: boot the machine once, then fork() a copy of the booted
+//  machine for each client that connects to a UNIX-domain socket.
+//  --connect: be such a client.
+//
+//  A request is a header (one line per --load, --load-basic-bin or
+//  --jump-to the client was given, then a blank line), followed by
+//  whatever the client has for the machine's standard input. The
+//  child process uses the connection as its standard input, output
+//  and error, so it behaves just like a bobbin run with its input
+//  piped in, except that it starts from an already-booted machine.
+
+#include "bobbin-internal.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define HEADER_LINE_MAX 4096
+
+// Set in a child, once it's been handed its request.
+static bool served = false;
+
+static void make_addr(struct sockaddr_un *addr, const char *path,
+                      const char *opt)
+{
+    memset(addr, 0, sizeof *addr);
+    addr->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof addr->sun_path) {
+        DIE(2, "%s: socket path \"%s\" is too long.\n", opt, path);
+    }
+    strcpy(addr->sun_path, path);
+}
+
+/********** Server **********/
+
+static int listen_on(const char *path)
+{
+    struct sockaddr_un addr;
+    make_addr(&addr, path, "--serve");
+
+    // Clear away a socket left behind by an earlier server.
+    struct stat sb;
+    if (lstat(path, &sb) == 0 && S_ISSOCK(sb.st_mode)) {
+        (void) unlink(path);
+    }
+
+    errno = 0;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0
+        || bind(fd, (struct sockaddr *)&addr, sizeof addr) < 0
+        || listen(fd, 16) < 0) {
+
+        DIE(1, "--serve: couldn't listen on \"%s\": %s\n", path,
+            strerror(errno));
+    }
+    return fd;
+}
+
+// Read one header line from FD, a byte at a time (whatever follows
+//  the header is the machine's input, and mustn't be read here).
+static bool read_line(int fd, char *buf, size_t bufsz)
+{
+    size_t len = 0;
+    for (;;) {
+        char c;
+        ssize_t n = read(fd, &c, 1);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        if (c == '\n') break;
+        if (len + 1 < bufsz) buf[len++] = c;
+    }
+    buf[len] = '\0';
+    return true;
+}
+
+// In the child: take the connection as our standard I/O, and carry
+//  out the request's header.
+static void become_request(int conn)
+{
+    served = true;
+    dup2(conn, STDIN_FILENO);
+    dup2(conn, STDOUT_FILENO);
+    dup2(conn, STDERR_FILENO);
+    close(conn);
+
+    char line[HEADER_LINE_MAX];
+    for (;;) {
+        if (!read_line(STDIN_FILENO, line, sizeof line)) {
+            DIE(1, "--serve: connection closed during request header.\n");
+        }
+        if (line[0] == '\0') break;
+        dlypc_run_request(line);
+    }
+
+    event_fire(EV_SERVE_CLIENT);
+    // --max-runtime and the like count from here.
+    frame_count = 0;
+}
+
+static void reap(void)
+{
+    int status;
+    while (waitpid(-1, &status, WNOHANG) > 0) {
+        // Nothing to do: each child reports to its own client.
+    }
+}
+
+static void serve(Event *e)
+{
+    if (served) return;
+    // This hook may run ahead of the --delay-until-pc one at the
+    //  same location.
+    if (!dlypc_catch_up()) return;
+    // Children shouldn't inherit a drive that's still running.
+    if (!disk2_spin_down()) return;
+
+    int lfd = listen_on(cfg.serve_sock);
+    INFO("--serve: machine ready; listening on \"%s\".\n", cfg.serve_sock);
+
+    // Nothing in here looks at sigint_received; just let ^C stop us.
+    unhandle_sigint();
+    fflush(NULL);
+    for (;;) {
+        reap();
+        int conn = accept(lfd, NULL, NULL);
+        if (conn < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            DIE(1, "--serve: accept failed: %s\n", strerror(errno));
+        }
+
+        pid_t pid = fork();
+        if (pid < 0) {
+            WARN("--serve: fork failed: %s\n", strerror(errno));
+        } else if (pid == 0) {
+            close(lfd);
+            become_request(conn);
+            return; // ...and go run the machine.
+        }
+        close(conn);
+    }
+}
+
+void serve_init(void)
+{
+    if (!cfg.serve_sock) return;
+
+    word loc;
+    if (!dlypc_final_delay(&loc)) {
+        loc = MON_KEYIN;
+    }
+    event_pc_hook(EV_PRESTEP, loc, serve);
+}
+
+/********** Client **********/
+
+// Copy everything from IN to OUT that's ready. Returns false at EOF.
+static bool pump(int in, int out)
+{
+    char buf[4096];
+    ssize_t n = read(in, buf, sizeof buf);
+    if (n < 0 && errno == EINTR) return true;
+    if (n <= 0) return false;
+    for (ssize_t done = 0; done < n; ) {
+        ssize_t w = write(out, buf + done, n - done);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        done += w;
+    }
+    return true;
+}
+
+void serve_connect(void)
+{
+    if (!cfg.connect_sock) return;
+
+    struct sockaddr_un addr;
+    make_addr(&addr, cfg.connect_sock, "--connect");
+    errno = 0;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof addr) < 0) {
+        DIE(1, "--connect: couldn't connect to \"%s\": %s\n",
+            cfg.connect_sock, strerror(errno));
+    }
+
+    FILE *hdr = fdopen(dup(fd), "w");
+    if (hdr == NULL) {
+        DIE(1, "--connect: %s\n", strerror(errno));
+    }
+    dlypc_write_requests(hdr);
+    fputc('\n', hdr);
+    if (fclose(hdr) != 0) {
+        DIE(1, "--connect: couldn't send request: %s\n", strerror(errno));
+    }
+
+    struct pollfd fds[2] = {
+        { .fd = STDIN_FILENO, .events = POLLIN },
+        { .fd = fd, .events = POLLIN },
+    };
+    while (fds[1].fd >= 0) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            DIE(1, "--connect: poll failed: %s\n", strerror(errno));
+        }
+        if (fds[0].revents && !pump(STDIN_FILENO, fd)) {
+            // Let the machine see the end of its input.
+            shutdown(fd, SHUT_WR);
+            fds[0].fd = -1;
+        }
+        if (fds[1].revents && !pump(fd, STDOUT_FILENO)) {
+            fds[1].fd = -1;
+        }
+    }
+    exit(0);
+}
@@ -0,0 +1,237 @@
+//  state.c
+//
+//  Copyright (c) 2025 Micah John Cowan.
+//  This code is licensed under the MIT license.
+//  See the accompanying LICENSE file for details.
+
+//  Saving and restoring the machine's state (save-state, load-state,
+//  --save-state-at, --load-state).
+//
+//  A state file is one page of header (registers, soft switches,
+//  Disk ][ controller), followed by the full 128k RAM buffer. The RAM
+//  is page-aligned in the file so that loading can simply map it
+//  privately (copy-on-write) and run the machine directly out of
+//  the mapping.
+//
+//  The position within the current frame (cycle_count) isn't saved.
+//  --load-state loads before the first frame has begun, so the loaded
+//  machine starts a fresh frame, counting from zero; the debugger's
+//  load-state runs mid-frame, and the loaded machine finishes out that
+//  frame from wherever its count had reached. Either way, the next
+//  frame boundary (and so the frame timers) may come up to a frame
+//  sooner or later than it would have for the saved machine.
+//
+//  Disk contents aren't part of the state: we only save while the
+//  drives are stopped (or just spinning down), at which point
+//  everything written has been flushed out to the image files. The
+//  same disks (and other machine options) must be given when the
+//  state is loaded.
+
+#include "bobbin-internal.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char STATE_MAGIC[8] = "BOBBINSS";
+#define STATE_VERSION   2
+#define STATE_HDR_SIZE  4096
+#define STATE_FILE_SIZE (STATE_HDR_SIZE + MEM_RAM_SIZE)
+#define ROMNAME_SIZE    32
+
+static char errbuf[256];
+#define ERR(...) (snprintf(errbuf, sizeof errbuf, __VA_ARGS__), errbuf)
+
+// Mapping currently in use as the machine's RAM, if any.
+static byte *mapped = NULL;
+
+/********** Header encoding **********/
+
+struct cursor {
+    byte *p;
+};
+
+static void put(struct cursor *c, uintmax_t v, int nbytes)
+{
+    for (int i = 0; i != nbytes; ++i) {
+        *c->p++ = v & 0xFF;
+        v >>= 8;
+    }
+}
+
+static uintmax_t get(struct cursor *c, int nbytes)
+{
+    uintmax_t v = 0;
+    for (int i = 0; i != nbytes; ++i) {
+        v |= (uintmax_t)*c->p++ << (8 * i);
+    }
+    return v;
+}
+
+static void put_disk2(struct cursor *c, const Disk2State *d)
+{
+    put(c, d->drive_two, 1);
+    put(c, d->write_mode, 1);
+    put(c, d->data_register, 1);
+    for (int i = 0; i != 4; ++i) put(c, d->steppers[i], 1);
+    for (int i = 0; i != 2; ++i) put(c, d->cog[i], 1);
+    for (int i = 0; i != 2; ++i) put(c, d->halftrack[i], 1);
+}
+
+static void get_disk2(struct cursor *c, Disk2State *d)
+{
+    d->drive_two = get(c, 1);
+    d->write_mode = get(c, 1);
+    d->data_register = get(c, 1);
+    for (int i = 0; i != 4; ++i) d->steppers[i] = get(c, 1);
+    for (int i = 0; i != 2; ++i) d->cog[i] = get(c, 1);
+    for (int i = 0; i != 2; ++i) d->halftrack[i] = get(c, 1);
+}
+
+/********** Save/load **********/
+
+const char *state_save(const char *path)
+{
+    // Software that's done with the disk switches the motor off, but
+    //  it keeps spinning for a second; no need to wait for that.
+    if (!disk2_spin_down()) {
+        return ERR("can't save state while a disk drive is spinning.");
+    }
+
+    byte hdr[STATE_HDR_SIZE] = { 0 };
+    struct cursor c = { hdr };
+    memcpy(c.p, STATE_MAGIC, sizeof STATE_MAGIC);
+    c.p += sizeof STATE_MAGIC;
+    put(&c, STATE_VERSION, 4);
+    strncpy((char *)c.p, default_romfname, ROMNAME_SIZE - 1);
+    c.p += ROMNAME_SIZE;
+    put(&c, cfg.amt_ram, 4);
+    put(&c, cfg.lang_card, 1);
+
+    put(&c, PC, 2);
+    put(&c, SP, 1);
+    put(&c, PFLAGS, 1);
+    put(&c, ACC, 1);
+    put(&c, XREG, 1);
+    put(&c, YREG, 1);
+
+    for (size_t i = 0; i != sizeof ss; ++i) put(&c, ss[i], 1);
+
+    Disk2State d;
+    disk2_get_state(&d);
+    put_disk2(&c, &d);
+
+    errno = 0;
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) {
+        return ERR("couldn't open \"%s\" for writing: %s", path,
+                   strerror(errno));
+    }
+    if (fwrite(hdr, 1, sizeof hdr, f) != sizeof hdr
+        || fwrite(getram(), 1, MEM_RAM_SIZE, f) != MEM_RAM_SIZE
+        || fclose(f) != 0) {
+
+        return ERR("couldn't write \"%s\": %s", path, strerror(errno));
+    }
+    return NULL;
+}
+
+const char *state_load(const char *path)
+{
+    if (drive_spinning()) {
+        return ERR("can't load state while a disk drive is spinning.");
+    }
+
+    errno = 0;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return ERR("couldn't open \"%s\": %s", path, strerror(errno));
+    }
+    struct stat sb;
+    if (fstat(fd, &sb) < 0 || sb.st_size != STATE_FILE_SIZE) {
+        close(fd);
+        return ERR("\"%s\" is not a bobbin state file.", path);
+    }
+    byte *map = mmap(NULL, STATE_FILE_SIZE, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return ERR("couldn't map \"%s\": %s", path, strerror(errno));
+    }
+
+    const char *err = NULL;
+    struct cursor c = { map };
+    char romname[ROMNAME_SIZE];
+    if (memcmp(c.p, STATE_MAGIC, sizeof STATE_MAGIC) != 0) {
+        err = ERR("\"%s\" is not a bobbin state file.", path);
+        goto bail;
+    }
+    c.p += sizeof STATE_MAGIC;
+    if (get(&c, 4) != STATE_VERSION) {
+        err = ERR("\"%s\" was saved by an incompatible bobbin.", path);
+        goto bail;
+    }
+    memcpy(romname, c.p, ROMNAME_SIZE);
+    romname[ROMNAME_SIZE - 1] = '\0';
+    c.p += ROMNAME_SIZE;
+    size_t amt_ram = get(&c, 4);
+    bool lang_card = get(&c, 1);
+    if (!STREQ(romname, default_romfname) || amt_ram != cfg.amt_ram
+        || lang_card != cfg.lang_card) {
+
+        err = ERR("\"%s\" was saved from a different machine"
+                  " configuration.", path);
+        goto bail;
+    }
+
+    PC = get(&c, 2);
+    SP = get(&c, 1);
+    PFLAGS = get(&c, 1);
+    ACC = get(&c, 1);
+    XREG = get(&c, 1);
+    YREG = get(&c, 1);
+
+    for (size_t i = 0; i != sizeof ss; ++i) ss[i] = get(&c, 1);
+
+    Disk2State d;
+    get_disk2(&c, &d);
+    disk2_set_state(&d);
+
+    mem_use_ram(map + STATE_HDR_SIZE);
+    if (mapped) munmap(mapped, STATE_FILE_SIZE);
+    mapped = map;
+    event_fire(EV_STATE_LOAD);
+    return NULL;
+
+bail:
+    munmap(map, STATE_FILE_SIZE);
+    return err;
+}
+
+/********** Options **********/
+
+static void save_state_at(Event *e)
+{
+    // If a drive is still in use, we'll just have to wait for
+    //  the next time we're here.
+    if (!disk2_spin_down()) return;
+
+    const char *err = state_save(cfg.save_state_file);
+    if (err) DIE(1, "--save-state-at: %s\n", err);
+    event_fire(EV_UNHOOK);
+    INFO("Saved state to \"%s\".\n", cfg.save_state_file);
+    exit(0);
+}
+
+void state_init(void)
+{
+    if (cfg.load_state) {
+        const char *err = state_load(cfg.load_state);
+        if (err) DIE(1, "--load-state: %s\n", err);
+    }
+    if (cfg.save_state_file) {
+        event_pc_hook(EV_PRESTEP, cfg.save_state_at, save_state_at);
+    }
+}
@@ -0,0 +1,172 @@
+//  stats.c
+//
+//  Copyright (c) 2025 Micah John Cowan.
+//  This code is licensed under the MIT license.
+//  See the accompanying LICENSE file for details.
+
+//  --stats, and the debugger's "stats on": counters (and host time
+//  totals) for the emulator's own busiest paths. The counting itself
+//  is done where things happen, guarded by stats_on, so that it costs
+//  next to nothing while switched off.
+
+#include "bobbin-internal.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+bool stats_on = false;
+StatCounters counters;
+
+static uintmax_t started;       // host time counting started
+static uintmax_t elapsed = 0;   // host time counted, until started
+
+static const char *const event_names[EV_NUM_TYPES] = {
+    [EV_NONE] = "none",
+    [EV_INIT] = "init",
+    [EV_START] = "start",
+    [EV_REBOOT] = "reboot",
+    [EV_RESET] = "reset",
+    [EV_PRESTEP] = "prestep",
+    [EV_STEP] = "step",
+    [EV_PEEK] = "peek",
+    [EV_POKE] = "poke",
+    [EV_SWITCH] = "switch",
+    [EV_CYCLE] = "cycle",
+    [EV_FRAME] = "frame",
+    [EV_UNHOOK] = "unhook",
+    [EV_REHOOK] = "rehook",
+    [EV_DISPLAY_TOUCH] = "display-touch",
+    [EV_DISK_ACTIVE] = "disk-active",
+    [EV_STATE_LOAD] = "state-load",
+    [EV_SERVE_CLIENT] = "serve-client",
+};
+
+uintmax_t stats_clock(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uintmax_t)ts.tv_sec * ONE_SEC_IN_NS + ts.tv_nsec;
+}
+
+static void count_frame(Event *e)
+{
+    if (stats_on) counters.cycles += CYCLES_PER_FRAME;
+}
+
+void stats_enable(bool on)
+{
+    static bool handler_registered = false;
+    if (on == stats_on) return;
+    if (on) {
+        if (!handler_registered) {
+            event_reghandler(count_frame, EVMASK(EV_FRAME));
+            handler_registered = true;
+        }
+        memset(&counters, 0, sizeof counters);
+        // The tables count_access() uses are only kept up while
+        //  counting.
+        mem_map_invalidate();
+        // The frame in progress counts from here.
+        counters.cycles = -cycle_count;
+        elapsed = 0;
+        started = stats_clock();
+    } else {
+        counters.cycles += cycle_count;
+        elapsed += stats_clock() - started;
+    }
+    stats_on = on;
+}
+
+static double secs(uintmax_t ns)
+{
+    return ns / (double)ONE_SEC_IN_NS;
+}
+
+void stats_print(FILE *f)
+{
+    uintmax_t host = elapsed;
+    uintmax_t cycles = counters.cycles;
+    if (stats_on) {
+        host += stats_clock() - started;
+        cycles += cycle_count;
+    }
+    if (host == 0) {
+        fprintf(f, "No emulator statistics collected"
+                   " (use --stats, or \"stats on\").\n");
+        return;
+    }
+
+    fprintf(f, "host time:        %.3f s (%.3f s asleep)\n", secs(host),
+            secs(counters.sleep_ns));
+    fprintf(f, "emulated cycles:  %" PRIuMAX "\n", cycles);
+    fprintf(f, "effective MHz:    %.3f", cycles / (host / 1000.0));
+    if (host > counters.sleep_ns) {
+        fprintf(f, " (%.3f while awake)",
+                cycles / ((host - counters.sleep_ns) / 1000.0));
+    }
+    fputc('\n', f);
+    fprintf(f, "frames:           %" PRIuMAX " slept, %" PRIuMAX
+               " caught up, %" PRIuMAX " too far behind\n",
+            counters.frames_slept, counters.frames_catchup,
+            counters.frames_overrun);
+    fprintf(f, "keyboard idle:    %" PRIuMAX " frames\n", counters.frames_idle);
+    fprintf(f, "I/O acceleration: %" PRIuMAX " frames, %.3f s saved\n",
+            counters.accel_frames, secs(counters.accel_saved_ns));
+
+    fprintf(f, "events:\n");
+    for (int t = 0; t != EV_NUM_TYPES; ++t) {
+        if (counters.events[t] == 0) continue;
+        fprintf(f, "  %-16s%12" PRIuMAX "  %9.3f s\n", event_names[t],
+                counters.events[t], secs(counters.event_ns[t]));
+    }
+
+    fprintf(f, "memory:                  peeks        pokes\n");
+    for (int m = MA_MAIN; m <= MA_LANG_CARD; ++m) {
+        if (counters.peeks[m] == 0 && counters.pokes[m] == 0) continue;
+        fprintf(f, "  %-16s%12" PRIuMAX " %12" PRIuMAX "\n",
+                mem_get_acctype_name(m), counters.peeks[m], counters.pokes[m]);
+    }
+
+    const char *hdr = "soft switch changes:\n";
+    for (int s = 0; s != STATS_NSWITCHES; ++s) {
+        if (counters.switches[s] == 0) continue;
+        fputs(hdr, f);
+        hdr = "";
+        fprintf(f, "  %-16s%12" PRIuMAX "\n", get_switch_name(s),
+                counters.switches[s]);
+    }
+
+    hdr = "peripheral handlers:\n";
+    for (int s = 0; s != 8; ++s) {
+        if (counters.periph_calls[s] == 0) continue;
+        fputs(hdr, f);
+        hdr = "";
+        fprintf(f, "  slot %d          %12" PRIuMAX "  %9.3f s\n", s,
+                counters.periph_calls[s], secs(counters.periph_ns[s]));
+    }
+
+    fprintf(f, "disk ][ bytes:    %" PRIuMAX " read, %" PRIuMAX " written\n",
+            counters.disk_bytes_read, counters.disk_bytes_written);
+    fprintf(f, "hard disk blocks: %" PRIuMAX " read, %" PRIuMAX " written\n",
+            counters.hdd_blocks_read, counters.hdd_blocks_written);
+    fprintf(f, "hard disk cache:  %" PRIuMAX " hits, %" PRIuMAX " misses\n",
+            counters.hdd_cache_hits, counters.hdd_cache_misses);
+    fprintf(f, "hard disk syncs:  %" PRIuMAX ", %.3f s (longest %.3f s)\n",
+            counters.hdd_syncs, secs(counters.hdd_sync_ns),
+            secs(counters.hdd_sync_max_ns));
+}
+
+static void print_at_exit(void)
+{
+    fputc('\n', stderr);
+    stats_print(stderr);
+}
+
+void stats_init(void)
+{
+    if (!cfg.stats) return;
+    stats_enable(true);
+    atexit(print_at_exit);
+}
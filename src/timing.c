@@ -6,17 +6,68 @@
 
 #include "bobbin-internal.h"
 
+#include <poll.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <time.h>
 
+// Frames are paced against absolute deadlines: frame K of a run is due
+//  at base + K frame-lengths, so that rounding in any one sleep never
+//  accumulates. If the host falls behind (a stall, a slow frame), we
+//  run flat out to catch up - but only so far: once we're more than
+//  MAX_BEHIND frames late, the schedule starts over from now, rather
+//  than racing through everything that was missed.
+#define MAX_BEHIND  6
+
+// --io-accel: while disks are busy, run faster than --speed (or flat
+//  out). So that a burst of short disk accesses (DOS switches the motor
+//  off after each sector it reads) doesn't flip-flop between speeds,
+//  acceleration continues for HOLD_FRAMES after the last sign of
+//  activity - unless the machine starts checking the keyboard, which
+//  means whatever it was loading has finished, and it's waiting on the
+//  user (or running, and may want to see whether a key is pressed).
+#define HOLD_FRAMES 30
+
+// A program waiting on a key spins in a tight loop, reading the
+//  keyboard every few cycles from the same spot. Once IDLE_POLLS reads
+//  in a row have come up empty from one PC, no more than IDLE_GAP
+//  cycles apart, we call the machine idle: it still runs every frame
+//  (so its cycle counts, and anything timed by frames, stay exactly as
+//  they'd be otherwise), but is paced at --speed even under --turbo,
+//  and sleeps out each frame in poll() on the interface's input, so
+//  that a keypress is seen at once. Nor does the interface go looking
+//  for input that poll() hasn't reported.
+#define IDLE_POLLS  16
+#define IDLE_GAP    256
+
 struct timing_t {
-    bool    first_time;
-    int     count;
-    struct timespec ts;
-    long    overslept;
+    bool        first_time;
+    uintmax_t   base;       // host ns at which frame 0 was due
+    uintmax_t   frames;     // frames since then
+    double      speed;      // the speed frames are paced at, now
+    double      frame_ns;   // host ns per emulated frame, at that speed
+    uintmax_t   last;       // host ns at the previous frame
+    bool        accel;      // was the previous frame accelerated?
 };
 
+static enum {
+    ACCEL_OFF,
+    ACCEL_TURBO,
+    ACCEL_SPEED,
+} accel_policy;
+static double accel_speed;
+static bool motor_running = false;
+static unsigned int hold = 0;   // frames of acceleration left
+
+static int idle_fd = -1;
+static bool idle = false;
+static bool kbd_polled = false; // since the last frame
+static bool input_maybe = true;
+static word idle_pc;
+static unsigned int idle_polls = 0;
+static uintmax_t idle_last;     // emulated cycle of the last empty read
+
 #ifdef BOBBIN_TIMINGS_DEBUG
 FILE    *tf;
 #define timdbg(...)   fprintf(tf, __VA_ARGS__)
@@ -28,8 +79,31 @@ struct timing_t  *timing_init(void)
 {
     struct timing_t *t = xalloc(sizeof *t);
     t->first_time = true;
-    t->count = 0;
-    t->overslept = 0;
+    t->speed = 0;
+    t->last = 0;
+    t->accel = false;
+
+    const char *p = cfg.io_accel;
+    if (p == NULL) {
+        // What the tty interface has always done, unless told
+        //  --turbo or --no-turbo.
+        p = cfg.turbo_was_set? "off" : "turbo";
+    }
+    if (STREQ(p, "off")) {
+        accel_policy = ACCEL_OFF;
+    } else if (STREQ(p, "turbo")) {
+        accel_policy = ACCEL_TURBO;
+    } else {
+        char *end;
+        accel_speed = strtod(p, &end);
+        if (end != p && (*end == 'x' || *end == 'X')) ++end;
+        if (end == p || *end != '\0' || !(accel_speed >= 0.01)
+            || accel_speed > 1000) {
+            DIE(2, "--io-accel: expected off, turbo, or a speed"
+                " (like 10x), not \"%s\".\n", p);
+        }
+        accel_policy = ACCEL_SPEED;
+    }
 
 #ifdef BOBBIN_TIMINGS_DEBUG
     tf = fopen("timings.dbg", "w");
@@ -37,90 +111,170 @@ struct timing_t  *timing_init(void)
     return t;
 }
 
-struct timespec
-timing_subtract(struct timespec a, struct timespec b)
+static uintmax_t now_ns(void)
 {
-    if (b.tv_nsec > a.tv_nsec) {
-        a.tv_nsec += ONE_SEC_IN_NS;
-        a.tv_sec -= 1;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uintmax_t)ts.tv_sec * ONE_SEC_IN_NS + ts.tv_nsec;
+}
+
+void timing_io_signal(AccelSignal s)
+{
+    switch (s) {
+        case ACCEL_MOTOR_ON:
+            motor_running = true;
+            hold = HOLD_FRAMES;
+            break;
+        case ACCEL_MOTOR_OFF:
+            motor_running = false;
+            hold = HOLD_FRAMES;
+            break;
+        case ACCEL_BLOCK_IO:
+            hold = HOLD_FRAMES;
+            break;
+    }
+}
+
+void timing_kbd_read(byte val)
+{
+    if (val & 0x80) {
+        // A key. Whatever was waiting on it is busy now.
+        idle = false;
+        idle_polls = 0;
+        return;
     }
-    a.tv_sec -= b.tv_sec;
-    a.tv_nsec -= b.tv_nsec;
 
-    return a;
+    // The machine checked for a key, and none was waiting: whatever
+    //  it was loading has finished.
+    if (!motor_running) hold = 0;
+
+    if (idle_fd < 0) return;
+    uintmax_t now = frame_count * CYCLES_PER_FRAME + cycle_count;
+    word pc = current_pc();
+    if (idle_polls != 0 && pc == idle_pc && now - idle_last <= IDLE_GAP) {
+        if (idle_polls < IDLE_POLLS) ++idle_polls;
+    } else {
+        idle_pc = pc;
+        idle_polls = 1;
+    }
+    idle_last = now;
+    idle = idle_polls == IDLE_POLLS;
+    kbd_polled = true;
 }
 
+void timing_idle_fd(int fd)
+{
+    idle_fd = fd;
+}
+
+bool timing_input_pending(void)
+{
+    return !idle || input_maybe;
+}
+
+void timing_input_drained(void)
+{
+    if (idle) input_maybe = false;
+}
+
+// Is I/O acceleration in effect for the coming frame?
+static bool accelerating(void)
+{
+    if (accel_policy == ACCEL_OFF) return false;
+    if (motor_running) return true;
+    if (hold == 0) return false;
+    --hold;
+    return true;
+}
 
 void timing_adjust(struct timing_t *t)
 {
-    struct timespec now;
-    clock_gettime(CLOCK_MONOTONIC, &now);
+    uintmax_t now = now_ns();
+    if (t->accel && !cfg.turbo) {
+        // Count the time saved over running that frame at --speed.
+        uintmax_t took = now - t->last;
+        uintmax_t normal = NS_PER_FRAME / cfg.speed;
+        if (stats_on) {
+            ++counters.accel_frames;
+            if (took < normal) counters.accel_saved_ns += normal - took;
+        }
+    }
+    bool accel = accelerating();
+    t->last = now;
+    t->accel = accel;
+
+    // A program that stops reading the keyboard isn't waiting on it.
+    if (!kbd_polled) idle = false;
+    kbd_polled = false;
+    bool idling = idle && !accel;
+    if (!idle) input_maybe = true;
+    if (stats_on && idling) ++counters.frames_idle;
 
-    if (t->count < 100) {
-        ++t->count;
+    if (rewind_replaying
+        || (!idling && (cfg.turbo || (accel && accel_policy == ACCEL_TURBO)))) {
+        // Not pacing; start a fresh schedule whenever we resume.
+        t->first_time = true;
+        return;
+    }
+
+    double speed = accel? accel_speed : cfg.speed;
+    if (speed != t->speed) {
+        t->speed = speed;
+        t->frame_ns = NS_PER_FRAME / speed;
+        t->first_time = true;
     }
 
     if (t->first_time) {
         t->first_time = false;
-        t->ts = now;
+        t->base = now;
+        t->frames = 0;
         return;
     }
 
-    struct timespec elapsed_ts = timing_subtract(now, t->ts);
-    long elapsed = elapsed_ts.tv_nsec;
-    if (elapsed_ts.tv_sec > 0)
-        elapsed = NS_PER_FRAME; // No more waiting required.
-
+    ++t->frames;
+    uintmax_t deadline = t->base + (uintmax_t)(t->frames * t->frame_ns);
     timdbg("--------------------\n");
-    if (elapsed < NS_PER_FRAME) {
-        long desired = NS_PER_FRAME - elapsed;
-
-        if (t->overslept >= desired) {
-            timdbg("%10ld elapsed\n", elapsed);
-            timdbg("Withdrawing desired time from previous overage.\n");
-            timdbg("%10ld desired, from\n", desired);
-            timdbg("%10ld oversleep;\n", t->overslept);
-            t->overslept -= desired;
-            timdbg("%10ld oversleep still remaining.\n", t->overslept);
+    if (now >= deadline) {
+        uintmax_t behind = now - deadline;
+        timdbg("%10ju behind\n", behind);
+        if (behind > MAX_BEHIND * t->frame_ns) {
+            timdbg("Too far behind; starting over.\n");
+            if (stats_on) ++counters.frames_overrun;
+            t->base = now;
+            t->frames = 0;
+        } else if (stats_on) {
+            ++counters.frames_catchup;
         }
-        else {
-            struct timespec sltime = now;
-            sltime.tv_sec = 0;
-            timdbg("%10ld elapsed\n%10ld desired\n",
-                   elapsed, (long)NS_PER_FRAME);
-            if (t->overslept > 0) {
-                desired -= t->overslept;
-                timdbg("%10ld oversleep BALANCE USED\n",
-                       t->overslept);
-                timdbg("%10ld desired FINAL\n", desired);
-                t->overslept = 0;
-            }
-            sltime.tv_nsec = desired;
-            // XXX: We don't handle when nanosleep is too little
-            // (interrupted by signal).
-            // The very occasional too-brief interval is acceptable.
-            (void) nanosleep(&sltime, NULL);
-            struct timespec actual;
-            clock_gettime(CLOCK_MONOTONIC, &actual);
-            struct timespec new_addtl_ts = timing_subtract(actual, now);
-            long new_addtl = new_addtl_ts.tv_nsec;
-            if (new_addtl_ts.tv_sec > 0) {
-                new_addtl = NS_PER_FRAME; // If the timer took over a
-                                          // second extra, (maybe we
-                                          // were suspended?),
-                                          // lock it to one second max.
-            }
-            if (new_addtl > desired) {
-                t->overslept = new_addtl - desired;
+        return;
+    }
+
+    timdbg("%10ju until deadline\n", deadline - now);
+    if (idling && !input_maybe) {
+        // Wait for input, or the deadline (to the ms; the sleep below
+        //  takes care of the rest).
+        struct pollfd pfd = { .fd = idle_fd, .events = POLLIN };
+        int ms = (deadline - now) / (ONE_SEC_IN_NS / 1000);
+        if (poll(&pfd, 1, ms) != 0) {
+            // Input (or an error, or a signal: let the interface see
+            //  to those). This frame ends now.
+            input_maybe = true;
+            if (stats_on) {
+                ++counters.frames_slept;
+                counters.sleep_ns += now_ns() - now;
             }
-            timdbg("%10ld actual additional\n%10ld oversleep\n",
-                   (long)new_addtl,
-                   (long)t->overslept);
-            now = actual;
+            return;
         }
-    } else {
-        timdbg("Frame took too long naturally, not sleeping any further.\n");
     }
-
-    t->ts = now;
+    struct timespec ts = {
+        .tv_sec = deadline / ONE_SEC_IN_NS,
+        .tv_nsec = deadline % ONE_SEC_IN_NS,
+    };
+    // An interrupted sleep just ends this frame early (it's most
+    //  likely a ^C, which wants a prompt response); the next deadline
+    //  is unaffected.
+    (void) clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+    if (stats_on) {
+        ++counters.frames_slept;
+        counters.sleep_ns += now_ns() - now;
+    }
 }
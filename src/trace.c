@@ -6,6 +6,8 @@
 
 #include "bobbin-internal.h"
 
+#include <errno.h>
+#include <pthread.h>
 #include <stdarg.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -19,35 +21,183 @@ FILE *trfile = NULL;
 
 static int traceon = 0;
 
+// Capture-time filters. An instruction outside the --trace-pc ranges
+//  is skipped, along with anything it does; reads and writes must
+//  also fall within the --trace-mem ranges. With --trace-pc, we only
+//  hook the locations it names, so that everything else can still be
+//  run without per-instruction events.
+static unsigned int kinds = TRACE_STEPS | TRACE_WRITES;
+static uint32_t pc_map[EVENT_MAP_SIZE];
+static bool pc_filtered = false;
+static uint32_t mem_map[EVENT_MAP_SIZE];
+static bool mem_filtered = false;
+static bool window_opened = false;     // --trace-to, under --trace-pc
+static bool window_closed = false;
+static bool switch_handler_registered = false;
+bool trace_reads = false;
+
+static void trace_switch(Event *e);
+
+/********** --trace-binary writer **********/
+
+// Binary records are collected in chunks, which a background thread
+//  writes out, so that the emulator only stops to wait for the disk
+//  when every chunk is full.
+#define CHUNK_RECS  4096
+#define NCHUNKS     8
+
+struct chunk {
+    size_t  len;
+    byte    buf[CHUNK_RECS * TRACE_REC_SIZE];
+};
+
+static struct chunk *chunks = NULL;
+static unsigned int fill = 0;   // chunk the emulator is filling
+static unsigned int drain = 0;  // next chunk for the writer
+static unsigned int nfull = 0;  // chunks awaiting the writer
+static bool stopping = false;
+static bool write_failed = false;
+static pthread_t writer;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t have_full = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t have_empty = PTHREAD_COND_INITIALIZER;
+
+static void *write_chunks(void *arg)
+{
+    pthread_mutex_lock(&lock);
+    for (;;) {
+        while (nfull == 0 && !stopping)
+            pthread_cond_wait(&have_full, &lock);
+        if (nfull == 0) break;
+
+        struct chunk *ch = &chunks[drain];
+        pthread_mutex_unlock(&lock);
+        if (write_failed) {
+            // Just discard it.
+        } else if (fwrite(ch->buf, 1, ch->len, trfile) != ch->len
+                   || fflush(trfile) != 0) {
+
+            WARN("Couldn't write trace file \"%s\": %s\n",
+                 cfg.trace_file, strerror(errno));
+            write_failed = true;
+        }
+        ch->len = 0;
+        pthread_mutex_lock(&lock);
+
+        drain = (drain + 1) % NCHUNKS;
+        --nfull;
+        pthread_cond_signal(&have_empty);
+    }
+    pthread_mutex_unlock(&lock);
+    return NULL;
+}
+
+// Hand the chunk being filled to the writer (if it has anything),
+//  waiting for an empty one to fill next.
+static void submit_chunk(void)
+{
+    if (chunks[fill].len == 0) return;
+
+    pthread_mutex_lock(&lock);
+    ++nfull;
+    pthread_cond_signal(&have_full);
+    fill = (fill + 1) % NCHUNKS;
+    while (nfull == NCHUNKS)
+        pthread_cond_wait(&have_empty, &lock);
+    pthread_mutex_unlock(&lock);
+}
+
+static void finish_writer(void)
+{
+    submit_chunk();
+    pthread_mutex_lock(&lock);
+    stopping = true;
+    pthread_cond_signal(&have_full);
+    pthread_mutex_unlock(&lock);
+    pthread_join(writer, NULL);
+    fclose(trfile);
+}
+
+static void start_writer(void)
+{
+    chunks = xalloc(NCHUNKS * sizeof *chunks);
+    for (int i = 0; i != NCHUNKS; ++i)
+        chunks[i].len = 0;
+    int err = pthread_create(&writer, NULL, write_chunks, NULL);
+    if (err != 0) {
+        DIE(1, "Couldn't start trace writer thread: %s\n", strerror(err));
+    }
+    atexit(finish_writer);
+}
+
+static void record(const TraceRec *r)
+{
+    if (!cfg.trace_binary) {
+        tracefmt_print(trfile, r);
+        return;
+    }
+
+    struct chunk *ch = &chunks[fill];
+    tracefmt_encode(&ch->buf[ch->len], r);
+    ch->len += TRACE_REC_SIZE;
+    if (ch->len == sizeof ch->buf)
+        submit_chunk();
+}
+
+/********************/
+
 void trace_on(char *format, ...)
 {
     va_list args;
 
     if (trfile == NULL) {
-        trfile = fopen(cfg.trace_file, "w");
+        trfile = fopen(cfg.trace_file, cfg.trace_binary? "wb" : "w");
         if (trfile == NULL) {
             perror("Couldn't open trace file");
             exit(2);
         }
-        setvbuf(trfile, NULL, _IOLBF, 0);
+        if (cfg.trace_binary) {
+            start_writer();
+            TraceRec hdr = { .type = TR_HEADER,
+                             .enhanced = machine_is_enhanced_iie() };
+            record(&hdr);
+        } else {
+            setvbuf(trfile, NULL, _IOLBF, 0);
+        }
     }
 
-    fprintf(trfile, "\n\n~~~ TRACING STARTED: ");
+    TraceRec r = { .type = TR_START };
     va_start(args, format);
-    vfprintf(trfile, format, args);
+    vsnprintf(r.text, sizeof r.text, format, args);
     va_end(args);
-    fprintf(trfile, " ~~~\n");
+    record(&r);
     traceon = 1;
-    if (!handler_registered) {
-        handler_registered = true;
-        event_reghandler(trace_step);
+    trace_reads = (kinds & TRACE_READS) != 0;
+    trace_reg();
+    if ((kinds & TRACE_SWITCHES) && !switch_handler_registered) {
+        switch_handler_registered = true;
+        event_reghandler(trace_switch, EVMASK(EV_SWITCH));
     }
 }
 
 void trace_off(void)
 {
-    fprintf(trfile, "~~~ TRACING FINISHED ~~~\n");
+    TraceRec r = { .type = TR_FINISH };
+    record(&r);
+    if (cfg.trace_binary) {
+        // Let what we have so far reach the file.
+        submit_chunk();
+    }
     traceon = 0;
+    trace_reads = false;
+}
+
+// Whether to trace an event of the given KIND, for the instruction
+//  under way.
+static inline bool wanted(unsigned int kind)
+{
+    return traceon && (kinds & kind)
+        && (!pc_filtered || event_watched(pc_map, current_pc()));
 }
 
 void trace_step(Event *e)
@@ -55,45 +205,105 @@ void trace_step(Event *e)
     if (e->type != EV_STEP) return;
     if (cfg.trace_start == cfg.trace_end) {
         // Do nothing.
+    } else if (pc_filtered) {
+        // We only see the --trace-pc locations, and may have gone
+        //  past either end of the window since the last one.
+        if (!window_opened && instr_count >= cfg.trace_start) {
+            window_opened = true;
+            trace_on("Requested by user");
+        }
+        if (!window_closed && instr_count >= cfg.trace_end) {
+            window_closed = true;
+            trace_off();
+        }
     } else if (instr_count == cfg.trace_start) {
         trace_on("Requested by user");
     } else if (instr_count == cfg.trace_end) {
         trace_off();
     }
 
-    if (traceon) {
-        fprintf(trfile, "%79ju\n", instr_count);
-        util_print_state(trfile, current_pc(), &theCpu.regs);
+    if (wanted(TRACE_STEPS)) {
+        TraceRec r = { .type = TR_STEP, .instr = instr_count };
+        disasm_snap_state(&r.state, current_pc(), &theCpu.regs);
+        record(&r);
     }
 }
 
+
+static void trace_switch(Event *e)
+{
+    if (!wanted(TRACE_SWITCHES)) return;
+    TraceRec r = { .type = TR_SWITCH, .val = swget(ss, e->val) };
+    strncpy(r.text, get_switch_name(e->val), TRACE_TEXT_MAX - 1);
+    record(&r);
+}
+
+void trace_disk(TraceDiskOp op, int unit, unsigned long val)
+{
+    if (!wanted(TRACE_DISK)) return;
+    TraceRec r = { .type = TR_DISK, .diskop = op, .unit = unit, .num = val };
+    record(&r);
+}
+
+static void trace_access(TraceRecType type, word loc, byte val)
+{
+    TraceRec r = { .type = type, .loc = loc, .val = val };
+    MemAccessType acc;
+    mem_get_true_access(loc, type == TR_WRITE, &r.aloc, &r.aux, &acc);
+    strncpy(r.acctype, mem_get_acctype_name(acc), TRACE_ACCTYPE_MAX);
+    record(&r);
+}
+
 void trace_write(word loc, byte val)
 {
-    if (traceon) {
-        size_t aloc;
-        MemAccessType acc;
-        bool aux;
-        mem_get_true_access(loc, true /* writing */, &aloc, &aux, &acc);
-        fprintf(trfile, "w @%05zX $%04X :%02X %s%s\n", aloc, loc, val,
-                mem_get_acctype_name(acc), aux? " (AUX)" : "");
+    if (wanted(TRACE_WRITES)
+        && (!mem_filtered || event_watched(mem_map, loc))) {
+        trace_access(TR_WRITE, loc, val);
     }
 }
 
 void trace_read(word loc, byte val)
 {
-    if (traceon) {
-        size_t aloc;
-        MemAccessType acc;
-        mem_get_true_access(loc, false /* reading */, &aloc, NULL, &acc);
-        fprintf(trfile, "r @%05zX $%04X :%02X %s\n", aloc, loc, val, mem_get_acctype_name(acc));
+    if (wanted(TRACE_READS)
+        && (!mem_filtered || event_watched(mem_map, loc))) {
+        trace_access(TR_READ, loc, val);
+    }
+}
+
+static void map_range(uint32_t *map, word first, word last)
+{
+    for (unsigned long loc = first; loc <= last; ++loc) {
+        map[loc / 32] |= (uint32_t)1 << (loc % 32);
     }
 }
 
+void trace_select(unsigned int k)
+{
+    kinds = k;
+}
+
+void trace_filter_pc(word first, word last)
+{
+    map_range(pc_map, first, last);
+    pc_filtered = true;
+}
+
+void trace_filter_mem(word first, word last)
+{
+    map_range(mem_map, first, last);
+    mem_filtered = true;
+}
+
 void trace_reg(void)
 {
-    if (!handler_registered) {
-        handler_registered = true;
-        event_reghandler(trace_step);
+    if (handler_registered) return;
+    handler_registered = true;
+    if (!pc_filtered) {
+        event_reghandler(trace_step, EVMASK(EV_STEP));
+        return;
+    }
+    for (unsigned long pc = 0; pc != 0x10000; ++pc) {
+        if (event_watched(pc_map, pc)) event_pc_hook(EV_STEP, pc, trace_step);
     }
 }
 
@@ -0,0 +1,79 @@
+//  tracedump.c
+//
+//  Copyright (c) 2025 Micah John Cowan.
+//  This code is licensed under the MIT license.
+//  See the accompanying LICENSE file for details.
+
+//  bobbin-tracedump: print a --trace-binary trace in the same text
+//  format bobbin writes without --trace-binary.
+//
+//  Usage: bobbin-tracedump [FILE]   (standard input if no FILE, or -)
+
+#include "bobbin-internal.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *progname = "bobbin-tracedump";
+static bool enhanced = false;
+
+// disasm.c wants these. Everything disassembled here comes from the
+//  memory captured in the trace, so the machine's memory is never
+//  actually consulted.
+bool machine_is_enhanced_iie(void)
+{
+    return enhanced;
+}
+
+byte peek_sneaky(word loc)
+{
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 2) {
+        fprintf(stderr, "Usage: %s [FILE]\n", progname);
+        return 2;
+    }
+
+    const char *fname = argc == 2? argv[1] : "-";
+    FILE *f = STREQ(fname, "-")? stdin : fopen(fname, "rb");
+    if (f == NULL) {
+        fprintf(stderr, "%s: Couldn't open \"%s\": %s\n", progname, fname,
+                strerror(errno));
+        return 1;
+    }
+
+    byte buf[TRACE_REC_SIZE];
+    TraceRec r;
+    unsigned long long nrecs = 0;
+    while (fread(buf, 1, sizeof buf, f) == sizeof buf) {
+        if (!tracefmt_decode(&r, buf)
+            || (nrecs == 0) != (r.type == TR_HEADER)) {
+
+            fflush(stdout);
+            fprintf(stderr, "%s: \"%s\": %s at record %llu.\n", progname,
+                    fname, nrecs == 0? "not a bobbin binary trace"
+                                     : "bad record", nrecs);
+            return 1;
+        }
+        if (r.type == TR_HEADER) {
+            enhanced = r.enhanced;
+        } else {
+            tracefmt_print(stdout, &r);
+        }
+        ++nrecs;
+    }
+    if (ferror(f)) {
+        fprintf(stderr, "%s: Couldn't read \"%s\": %s\n", progname, fname,
+                strerror(errno));
+        return 1;
+    }
+    if (fflush(stdout) != 0) {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,264 @@
+//  tracefmt.c
+//
+//  Copyright (c) 2025 Micah John Cowan.
+//  This code is licensed under the MIT license.
+//  See the accompanying LICENSE file for details.
+
+//  Trace records: the text trace format, and the fixed-size binary
+//  records of --trace-binary. Shared by bobbin (which writes traces)
+//  and bobbin-tracedump (which turns binary ones into text).
+//
+//  Every binary record is TRACE_REC_SIZE bytes, starting with its
+//  type; multi-byte fields are little-endian. The file starts with a
+//  TR_HEADER record.
+
+#include "bobbin-internal.h"
+
+#include <string.h>
+
+static const char TRACE_MAGIC[8] = "BOBBINTR";
+#define TRACE_VERSION   1
+
+struct cursor {
+    byte *p;
+};
+
+static void put(struct cursor *c, uintmax_t v, int nbytes)
+{
+    for (int i = 0; i != nbytes; ++i) {
+        *c->p++ = v & 0xFF;
+        v >>= 8;
+    }
+}
+
+static uintmax_t get(struct cursor *c, int nbytes)
+{
+    uintmax_t v = 0;
+    for (int i = 0; i != nbytes; ++i) {
+        v |= (uintmax_t)*c->p++ << (8 * i);
+    }
+    return v;
+}
+
+static void put_str(struct cursor *c, const char *s, size_t max)
+{
+    size_t len = strlen(s);
+    if (len > max) len = max;
+    put(c, len, 1);
+    memcpy(c->p, s, len);
+    c->p += len;
+}
+
+static void get_str(struct cursor *c, char *s, size_t max)
+{
+    size_t len = get(c, 1);
+    if (len > max) len = max;
+    memcpy(s, c->p, len);
+    s[len] = '\0';
+    c->p += len;
+}
+
+static void put_regs(struct cursor *c, const Registers *r)
+{
+    put(c, r->pc, 2);
+    put(c, r->a, 1);
+    put(c, r->x, 1);
+    put(c, r->y, 1);
+    put(c, r->sp, 1);
+    put(c, r->p, 1);
+}
+
+static void get_regs(struct cursor *c, Registers *r)
+{
+    r->pc = get(c, 2);
+    r->a = get(c, 1);
+    r->x = get(c, 1);
+    r->y = get(c, 1);
+    r->sp = get(c, 1);
+    r->p = get(c, 1);
+}
+
+void tracefmt_encode(byte *buf, const TraceRec *r)
+{
+    struct cursor c = { buf };
+    memset(buf, 0, TRACE_REC_SIZE);
+    put(&c, r->type, 1);
+    switch (r->type) {
+        case TR_HEADER:
+            memcpy(c.p, TRACE_MAGIC, sizeof TRACE_MAGIC);
+            c.p += sizeof TRACE_MAGIC;
+            put(&c, TRACE_VERSION, 4);
+            put(&c, r->enhanced, 1);
+            break;
+        case TR_START:
+            put_str(&c, r->text, TRACE_TEXT_MAX);
+            break;
+        case TR_FINISH:
+            break;
+        case TR_STEP:
+        {
+            const StateSnap *s = &r->state;
+            put(&c, r->instr, 8);
+            put_regs(&c, &s->regs);
+            memcpy(c.p, s->stack, sizeof s->stack);
+            c.p += sizeof s->stack;
+            memcpy(c.p, s->dis.m, sizeof s->dis.m);
+            c.p += sizeof s->dis.m;
+            put(&c, s->dis.nacc, 1);
+            for (int i = 0; i != s->dis.nacc; ++i) {
+                const DisasmWindow *w = &s->dis.acc[i];
+                put(&c, w->zp, 1);
+                put(&c, w->addr, 2);
+                memcpy(c.p, w->val, sizeof w->val);
+                c.p += sizeof w->val;
+            }
+        }
+            break;
+        case TR_READ:
+        case TR_WRITE:
+            put(&c, r->loc, 2);
+            put(&c, r->val, 1);
+            put(&c, r->aloc, 4);
+            put(&c, r->aux, 1);
+            put_str(&c, r->acctype, TRACE_ACCTYPE_MAX);
+            break;
+        case TR_SWITCH:
+            put(&c, r->val, 1);
+            put_str(&c, r->text, TRACE_TEXT_MAX - 1);
+            break;
+        case TR_DISK:
+            put(&c, r->diskop, 1);
+            put(&c, r->unit, 1);
+            put(&c, r->num, 4);
+            break;
+    }
+}
+
+bool tracefmt_decode(TraceRec *r, const byte *buf)
+{
+    struct cursor c = { (byte *)buf };
+    r->type = get(&c, 1);
+    switch (r->type) {
+        case TR_HEADER:
+            if (memcmp(c.p, TRACE_MAGIC, sizeof TRACE_MAGIC) != 0)
+                return false;
+            c.p += sizeof TRACE_MAGIC;
+            if (get(&c, 4) != TRACE_VERSION)
+                return false;
+            r->enhanced = get(&c, 1);
+            break;
+        case TR_START:
+            get_str(&c, r->text, TRACE_TEXT_MAX);
+            break;
+        case TR_FINISH:
+            break;
+        case TR_STEP:
+        {
+            StateSnap *s = &r->state;
+            r->instr = get(&c, 8);
+            get_regs(&c, &s->regs);
+            memcpy(s->stack, c.p, sizeof s->stack);
+            c.p += sizeof s->stack;
+            memcpy(s->dis.m, c.p, sizeof s->dis.m);
+            c.p += sizeof s->dis.m;
+            s->dis.pc = s->regs.pc;
+            s->dis.nacc = get(&c, 1);
+            if (s->dis.nacc > 2)
+                return false;
+            for (int i = 0; i != s->dis.nacc; ++i) {
+                DisasmWindow *w = &s->dis.acc[i];
+                w->zp = get(&c, 1);
+                w->addr = get(&c, 2);
+                memcpy(w->val, c.p, sizeof w->val);
+                c.p += sizeof w->val;
+            }
+        }
+            break;
+        case TR_READ:
+        case TR_WRITE:
+            r->loc = get(&c, 2);
+            r->val = get(&c, 1);
+            r->aloc = get(&c, 4);
+            r->aux = get(&c, 1);
+            get_str(&c, r->acctype, TRACE_ACCTYPE_MAX);
+            break;
+        case TR_SWITCH:
+            r->val = get(&c, 1);
+            get_str(&c, r->text, TRACE_TEXT_MAX - 1);
+            break;
+        case TR_DISK:
+            r->diskop = get(&c, 1);
+            if (r->diskop > TD_HDD_WRITE)
+                return false;
+            r->unit = get(&c, 1);
+            r->num = get(&c, 4);
+            break;
+        default:
+            return false;
+    }
+    return true;
+}
+
+static void print_disk(FILE *f, const TraceRec *r)
+{
+    const char *dev = r->diskop >= TD_HDD_READ? "hdd" : "drive";
+    fprintf(f, "d %s %d ", dev, (int)r->unit);
+    switch (r->diskop) {
+        case TD_MOTOR_ON:
+            fprintf(f, "motor on\n");
+            break;
+        case TD_MOTOR_OFF:
+            fprintf(f, "motor off\n");
+            break;
+        case TD_SELECT:
+            fprintf(f, "selected\n");
+            break;
+        case TD_HALFTRACK:
+            fprintf(f, "halftrack %lu\n", r->num);
+            break;
+        case TD_READ:
+            fprintf(f, "read :%02lX\n", r->num);
+            break;
+        case TD_WRITE:
+            fprintf(f, "write :%02lX\n", r->num);
+            break;
+        case TD_HDD_READ:
+            fprintf(f, "read block %lu\n", r->num);
+            break;
+        case TD_HDD_WRITE:
+            fprintf(f, "write block %lu\n", r->num);
+            break;
+    }
+}
+
+void tracefmt_print(FILE *f, const TraceRec *r)
+{
+    switch (r->type) {
+        case TR_HEADER:
+            break;
+        case TR_START:
+            fprintf(f, "\n\n~~~ TRACING STARTED: %s ~~~\n", r->text);
+            break;
+        case TR_FINISH:
+            fprintf(f, "~~~ TRACING FINISHED ~~~\n");
+            break;
+        case TR_STEP:
+            fprintf(f, "%79ju\n", r->instr);
+            disasm_print_state(f, &r->state);
+            break;
+        case TR_READ:
+            fprintf(f, "r @%05zX $%04X :%02X %s\n", r->aloc, r->loc, r->val,
+                    r->acctype);
+            break;
+        case TR_WRITE:
+            fprintf(f, "w @%05zX $%04X :%02X %s%s\n", r->aloc, r->loc, r->val,
+                    r->acctype, r->aux? " (AUX)" : "");
+            break;
+        case TR_SWITCH:
+            fprintf(f, "s %s %s\n", r->text, r->val? "on" : "off");
+            break;
+        case TR_DISK:
+            print_disk(f, r);
+            break;
+    }
+}
@@ -24,8 +24,11 @@ const char *get_file_ext(const char *path)
     return ext+1;
 }
 
+uintmax_t alloc_count = 0;
+
 void *xalloc(size_t sz)
 {
+    ++alloc_count;
     errno = 0;
     void *obj = malloc(sz);
     if (obj == NULL) {
@@ -60,10 +63,13 @@ int mmapfile(const char *fname, byte **buf, size_t *sz, int flags)
     int mflags = MAP_PRIVATE;
     if (flags & O_RDWR || flags & O_WRONLY) {
         protect |= PROT_WRITE;
-        mflags = MAP_SHARED;
+        // Under --serve, each copy of the machine writes to a
+        //  (copy-on-write) image of its own, not to the file.
+        if (!cfg.serve_sock) mflags = MAP_SHARED;
     }
     *buf = mmap(NULL, st.st_size, protect, mflags, fd, 0);
-    if (*buf == NULL) {
+    if (*buf == MAP_FAILED) {
+        *buf = NULL;
         err = errno;
         goto bail;
     }
@@ -150,41 +156,9 @@ int util_isprint(int c)
 
 void util_print_state(FILE *f, word pc, Registers *reg)
 {
-    static const char fnams[] = "CZIDBUVN";
-    // printf("\n12345678901234567890123456789012345678901234567890\n");
-
-    // Print registers
-    fprintf(f, "ACC: %02X  X: %02X  Y: %02X  SP: %02X", // takes 31 chars
-           reg->a, reg->x, reg->y, reg->sp);
-    fprintf(f, "%8c", ' '); // bring it to 39 (first flag starts on #41)
-
-    // Print status flags
-    for (int i=7; i != -1; --i) {
-        //if (i == PUNUSED) continue;
-        fputc(' ', f);
-        char c = fnams[i];
-        if (RPTEST(reg->p,i)) {
-            fprintf(f, " [%c]", c);
-        } else {
-            fprintf(f, "  %c ", c);
-        }
-    }
-    fputc('\n', f);
-
-    // Print stack
-    byte sp = reg->sp - 3;
-    fprintf(f, "STK: $1%02X:", sp);
-    for (int i=0; i != 13; ++i) {
-        if (!sp) fprintf(f, "  |");
-        if (sp == reg->sp)
-            fprintf(f, "  (%02X)", peek_sneaky(WORD(sp++,0x1)));
-        else
-            fprintf(f, "  %02X", peek_sneaky(WORD(sp++,0x1)));
-    }
-    fputc('\n', f);
-
-    // Print current location and instruction
-    (void) print_disasm(f, pc, reg);
+    StateSnap s;
+    disasm_snap_state(&s, pc, reg);
+    disasm_print_state(f, &s);
 }
 
 void util_reopen_stdin_tty(int flags)
@@ -24,6 +24,7 @@ static int inotify_fd = -1;
 void setup_watches(void)
 {
     if (!cfg.watch) return; // We're not doing watches.
+    if (cfg.replay_file) return; // The recording says when to reboot.
     if (wlist) return; // Don't do setup a second time.
 
     // Add watches for all the --load files
@@ -61,6 +62,7 @@ void add_watch(const char *fname)
 
 bool check_watches(void)
 {
+    if (replay_reboot_due()) return true;
     if (!sigalrm_received) return false;
 
     WRec *rec;
@@ -94,6 +96,7 @@ bool check_watches(void)
 
     if (changed) {
         WARN("Rewrite event for watched file \"%s\". Restarting...\n", changed);
+        record_reboot();
         event_fire(EV_REBOOT);
     }
     sigalrm_received = 0;
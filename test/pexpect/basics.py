@@ -79,3 +79,16 @@ def m_plus_simple_v_v(p):
 \r
 \r
 ]""" % {"bobbin": BOBBIN}, before)
+
+# Once --remain-tty has switched to the tty interface, the simple
+#  interface mustn't go on writing out what the machine prints.
+@bobbin('-m plus --simple -i /dev/null --remain-tty')
+def remain_tty_leaves_simple_behind(p):
+    p.expect(TIMEOUT)
+    p.send('PRINT "ZZ";"YY"\r')
+    p.expect(TIMEOUT)
+    if "ZZYY" not in p.before:
+        fail("tty interface didn't print ZZYY")
+    if "ZZYY\n" in p.before:
+        fail("simple interface still printing after --remain-tty")
+    return True
@@ -24,3 +24,139 @@ def ctrl_c_in_dbg(p):
     p.sendline("PRINT\"HELLO\"")
     p.expect("\r\nHELLO\r\n\r\n]")
     return True
+
+# Once up and running, the emulator shouldn't be touching the heap.
+@bobbin('-m plus --simple')
+def no_steady_state_allocs(p):
+    p.expect("\r\n]")
+    counts = []
+    for i in range(2):
+        p.sendintr()
+        p.expect(TIMEOUT)
+        p.sendintr()
+        p.expect("\r\n>")
+        p.sendline("stats")
+        p.expect("\r\nframes: +([0-9]+)\r\nheap allocations: +([0-9]+)\r\n")
+        counts.append((int(p.match.group(1)), int(p.match.group(2))))
+        p.sendline("c")
+        p.expect("\r\nContinuing...\r\n")
+        p.sendline("")
+        p.expect("\r\n]")
+    if counts[1][0] <= counts[0][0]:
+        fail("frames didn't advance: %s" % counts)
+    if counts[1][1] != counts[0][1]:
+        fail("heap allocations went from %d to %d"
+             % (counts[0][1], counts[1][1]))
+    return True
+
+@bobbin('-m plus --simple')
+def conditional_bp_and_watchpoint(p):
+    p.expect("\r\n]")
+    p.sendline("CALL -151")
+    p.expect("\r\n\\*")
+    # LDX #0; INX; STX $200; BNE -6; RTS
+    p.sendline("300: A2 00 E8 8E 00 02 D0 FA 60")
+    p.expect("\r\n\\*")
+    p.sendintr()
+    p.expect(TIMEOUT)
+    p.sendintr()
+    p.expect("\r\n>")
+    p.sendline("b 306 if X == $10 && [200] == X")
+    p.expect("\r\nBreakpoint 1 set for \\$0306, if X == \\$10 && \\[200\\] == X\\.\r\n")
+    p.sendline("b 306 if X ==")
+    p.expect("\r\nERR: expected a number or register, at \"\"\\.\r\n")
+    p.sendline("c")
+    p.expect("\r\nContinuing...\r\n")
+    p.sendline("")
+    p.expect("\r\n]")
+    p.sendline("CALL 768")
+    p.expect("\r\nBreakpoint 1 at \\$0306\\.\r\n")
+    p.expect("  X: 10  ")
+    p.sendline("disable 1")
+    p.expect("\r\nBreakpoint 1 disabled\\.\r\n")
+    p.sendline("w 200")
+    p.expect("\r\nWatchpoint 2 set for \\$0200 \\(cur val is \\$10\\)\\.\r\n")
+    p.sendline("c")
+    p.expect("\r\nWatchpoint 2 fired:\r\nWrite to \\$0200 \\(\\$10 -> \\$11\\)\\.\r\n")
+    return True
+
+@bobbin('-m plus --simple --rewind 4')
+def reverse_step_and_continue(p):
+    p.expect("\r\n]")
+    p.sendline("CALL -151")
+    p.expect("\r\n\\*")
+    # LDX #0; INX; STX $200; LDY #0; DEY; BNE -3; JMP $302
+    p.sendline("300: A2 00 E8 8E 00 02 A0 00 88 D0 FD 4C 02 03")
+    p.expect("\r\n\\*")
+    p.sendline("300G")
+    p.expect(TIMEOUT)
+    p.sendintr()
+    p.expect(TIMEOUT)
+    p.sendintr()
+    p.expect("\r\n>")
+    p.sendline("w 200")
+    p.expect("\r\nWatchpoint 1 set for \\$0200 \\(cur val is \\$([0-9A-F]{2})\\)\\.\r\n")
+    x = int(p.match.group(1), 16)
+    p.sendline("rc")
+    p.expect("\r\nWatchpoint 1 fired:\r\nWrite to \\$0200 \\(\\$([0-9A-F]{2}) -> \\$%02X\\)\\.\r\n" % x)
+    want_got("%02X" % ((x - 1) % 256), p.match.group(1))
+    p.expect("At instruction ([0-9]+)\\.\r\n")
+    n = int(p.match.group(1))
+    p.expect("\r\n0306: ")
+    p.sendline("rs")
+    p.expect("\r\nAt instruction %d\\.\r\n" % (n - 1))
+    p.expect("\r\n0303: ")
+    p.sendline("rc")
+    p.expect("\r\nWrite to \\$0200 \\(\\$%02X -> \\$%02X\\)\\.\r\n"
+             % ((x - 2) % 256, (x - 1) % 256))
+    p.sendline("c")
+    p.expect("\r\nContinuing...\r\n")
+    p.expect("\r\nWrite to \\$0200 \\(\\$%02X -> \\$%02X\\)\\.\r\n"
+             % ((x - 1) % 256, x))
+    p.sendline("rs")
+    p.expect("\r\nAt instruction")
+    p.expect("\r\n>")
+    # No disk in use: the past can be changed by hand.
+    p.sendline("2FF: 00")
+    p.expect("\r\n>")
+    p.sendline("2FF")
+    p.expect("\r\n02FF: 00\r\n")
+    return True
+
+# A replay can't put a spinning disk back as it was; changing the
+#  machine by hand mid-replay is refused while the drive's in use.
+#  (Booting from a blank disk leaves the motor running.)
+with open('blank.dsk', 'wb') as f:
+    f.write(bytes(143360))
+@bobbin('-m plus --simple --rewind 4 --disk blank.dsk')
+def no_diverging_with_disk_spinning(p):
+    p.expect(TIMEOUT)
+    p.sendintr()
+    p.expect(TIMEOUT)
+    p.sendintr()
+    p.expect("\r\n>")
+    p.sendline("rs")
+    p.expect("\r\nAt instruction")
+    p.expect("\r\n>")
+    p.sendline("2FF: 00")
+    p.expect("\r\nERR: can't change the past here: the disk drive was in use\\.\r\n")
+    return True
+
+# The tty interface watches writes to the text pages itself; a
+#  watchpoint there must fire all the same.
+@bobbin('-m plus')
+def watchpoint_on_text_page_tty(p):
+    p.expect(TIMEOUT)
+    p.sendintr()
+    p.expect(TIMEOUT)
+    p.sendintr()
+    p.expect("\r\n>")
+    p.sendline("w 400")
+    p.expect("Watchpoint 1 set for \\$0400 \\(cur val is \\$[0-9A-F]{2}\\)\\.\r\n")
+    p.sendline("c")
+    p.expect(TIMEOUT)
+    p.send("\r")   # (clear the line of the ^C that got through)
+    p.expect(TIMEOUT)
+    p.send("POKE 1024,193\r")
+    p.expect("Watchpoint 1 fired:\r\nWrite to \\$0400 \\(\\$[0-9A-F]{2} -> \\$C1\\)\\.\r\n")
+    return True
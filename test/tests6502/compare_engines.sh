@@ -0,0 +1,58 @@
+#!/bin/sh
+
+# Run each CPU test under --cpu-engine interp and --cpu-engine cached,
+# and check that both take exactly as many instructions, and cycles.
+#
+# Needs the assembled tests (ca65); without them, this test is SKIPPED
+# (exit status 77), not passed.
+
+: "${BOBBIN:?}" "${srcdir:=.}" "${builddir:=.}"
+
+missing=
+for test in $SRCS_6502 $SRCS_65C02; do
+    if ! test -e "$builddir/$test.bin"; then
+        missing="$missing $test.bin"
+    fi
+done
+if test -n "$missing"; then
+    echo "No assembled tests (is ca65 installed?):$missing"
+    echo 'SKIPPING comparison of --cpu-engine cached against interp.'
+    exit 77
+fi
+
+pass=0
+fail=0
+
+engine_run() {
+    test="$1"; shift
+    opts="$(sed -n 's/^;#options //p' < "$srcdir/$test.ca65")"
+    ( cd "$srcdir" && "$BOBBIN" --iface simple $xopts $opts "$@" \
+        --load="$builddir/$test.bin" \
+        --trap-failure 0x0001 --trap-success 0x0002 </dev/null 2>&1 ) \
+        | sed -n 's/^\(Instr #\|Cycles\): //p'
+}
+
+compare_engines() {
+    test="$1"
+    a="$(engine_run "$test" --cpu-engine interp)"
+    b="$(engine_run "$test" --cpu-engine cached)"
+    if test "x$a" = "x$b"; then
+        echo "$test ($xopts): engines match:" $a
+        pass=$(( pass + 1 ))
+    else
+        echo "$test ($xopts): ENGINES DIFFER: interp" $a ", cached" $b
+        fail=$(( fail + 1 ))
+    fi
+}
+
+xopts='-m enhanced'
+for test in $SRCS_65C02; do
+    compare_engines "$test"
+done
+xopts='-m plus'
+for test in $SRCS_6502; do
+    compare_engines "$test"
+done
+
+echo "$pass matched, $fail failed."
+test "$fail" -eq 0